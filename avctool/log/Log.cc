@@ -1,4 +1,19 @@
-﻿#include "log.h"
+﻿#include "Log.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <float.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
 
 namespace avc {
 namespace util {
@@ -19,18 +34,346 @@ const char *strLogLevel(unsigned level) {
     return szLogLevel[level];
 }
 
-LogContext::LogContext() {
-
+LogContext::LogContext() : std::ostream(nullptr) {
+    rdbuf(&buf_);
+    env_.level = LogLevel::kLogLevelTrace;
+    env_.file = "";
+    env_.func = "";
+    env_.line = 0;
+    env_.tv = timeval{0, 0};
+    env_.threadName = "";
 }
 
-LogContext::LogContext(int level, const char *file, const char* func, int line) {
+LogContext::LogContext(int level, const char *file, const char* func, int line) : std::ostream(nullptr) {
+    //基类先于buf_构造，构造完成后再设置streambuf
+    rdbuf(&buf_);
     env_.level = level;
     env_.file = file;
     env_.func = func;
     env_.line = line;
     //env_.time = util::gettimeofday();
     gettimeofday(&env_.tv, nullptr);
-    env_.threadName = getThreadName();
+    env_.threadName = getThreadNameCached();
+}
+
+LogContext::ContentBuf::int_type LogContext::ContentBuf::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    auto used = size();
+    auto capacity = (size_t)(epptr() - pbase()) * 2;
+    if (heap_.empty()) {
+        heap_.assign(inline_, used);
+    }
+    heap_.resize(capacity);
+    setp(&heap_[0], &heap_[0] + capacity);
+    pbump((int)used);
+
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+void LogContext::resolveDeferred() {
+    //正文缓冲中是编码后的参数，拷贝出来后再将格式化结果写回正文缓冲
+    static thread_local std::string s_raw;
+    s_raw.assign(buf_.data(), buf_.size());
+    buf_.clear();
+
+    auto decoder = decoder_;
+    decoder_ = nullptr;
+    decoder(*this, deferred_fmt_, s_raw.data(), s_raw.size());
+}
+
+void LogDeferred::formatV(LogContext &log, const char *fmt, ...) {
+    char buf[LogContext::kInlineSize];
+    va_list args;
+    va_start(args, fmt);
+    va_list copy;
+    va_copy(copy, args);
+    int size = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (size < 0) {
+        va_end(copy);
+        return;
+    }
+    if ((size_t)size < sizeof(buf)) {
+        log.append(buf, size);
+        va_end(copy);
+        return;
+    }
+
+    static thread_local std::string s_long;
+    s_long.resize(size + 1);
+    vsnprintf(&s_long[0], s_long.size(), fmt, copy);
+    va_end(copy);
+    log.append(s_long.data(), size);
+}
+
+void LogContext::addField(const LogKV &kv) {
+    if (field_count_ >= kMaxFields) {
+        return;
+    }
+    auto &field = fields_[field_count_++];
+    field.key = kv.key;
+    field.type = kv.type;
+    switch (kv.type) {
+    case LogKV::kString:
+        field.value.s.offset = (uint32_t)fields_text_.size();
+        field.value.s.size = (uint32_t)kv.size;
+        fields_text_.sputn(kv.str, kv.size);
+        break;
+    case LogKV::kInt: field.value.i = kv.value.i; break;
+    case LogKV::kUint: field.value.u = kv.value.u; break;
+    case LogKV::kDouble: field.value.d = kv.value.d; break;
+    case LogKV::kBool: field.value.b = kv.value.b; break;
+    }
+}
+
+std::ostream &operator<<(std::ostream &ost, const LogKV &kv) {
+    auto log = dynamic_cast<LogContext *>(&ost);
+    if (log) {
+        log->addField(kv);
+        return ost;
+    }
+    ost << ' ' << kv.key << '=';
+    switch (kv.type) {
+    case LogKV::kInt: ost << kv.value.i; break;
+    case LogKV::kUint: ost << kv.value.u; break;
+    case LogKV::kDouble: ost << kv.value.d; break;
+    case LogKV::kBool: ost << (kv.value.b ? "true" : "false"); break;
+    case LogKV::kString: ost.write(kv.str, kv.size); break;
+    }
+    return ost;
+}
+
+/**
+ * 格式化double：JSON不支持inf/nan，输出null
+*/
+static void writeDouble(std::ostream &ost, double value) {
+    if (value != value || value > DBL_MAX || value < -DBL_MAX) {
+        ost.write("null", 4);
+        return;
+    }
+    char buf[32];
+    int size = snprintf(buf, sizeof(buf), "%.15g", value);
+    ost.write(buf, size);
+}
+
+/**
+ * 格式化整数，避免经过std::ostream的locale处理
+*/
+static void writeInteger(std::ostream &ost, uint64_t value, bool negative) {
+    char buf[24];
+    auto end = buf + sizeof(buf);
+    auto pos = end;
+    do {
+        *--pos = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    if (negative) *--pos = '-';
+    ost.write(pos, end - pos);
+}
+
+static void writeFieldValue(std::ostream &ost, const LogContext &log, const LogContext::Field &field) {
+    switch (field.type) {
+    case LogKV::kInt:
+        writeInteger(ost, field.value.i < 0 ? 0 - (uint64_t)field.value.i : (uint64_t)field.value.i, field.value.i < 0);
+        break;
+    case LogKV::kUint: writeInteger(ost, field.value.u, false); break;
+    case LogKV::kDouble: writeDouble(ost, field.value.d); break;
+    case LogKV::kBool: field.value.b ? ost.write("true", 4) : ost.write("false", 5); break;
+    case LogKV::kString: ost.write(log.fieldText(field), field.value.s.size); break;
+    }
+}
+
+void LogChannel::formatFields(const LogContext::Ptr &log, std::ostream &ost) {
+    for (size_t index = 0; index < log->fieldCount(); ++index) {
+        auto &field = log->field(index);
+        ost.put(' ');
+        ost << field.key;
+        ost.put('=');
+        writeFieldValue(ost, *log, field);
+    }
+}
+
+void LogChannelJson::writeString(std::ostream &ost, const char *data, size_t size) {
+    static const char kHex[] = "0123456789abcdef";
+    ost.put('"');
+    //连续的普通字符一次写入，只对需要转义的字符单独处理
+    size_t start = 0;
+    for (size_t index = 0; index < size; ++index) {
+        auto ch = (unsigned char)data[index];
+        if (ch >= 0x20 && ch != '"' && ch != '\\') {
+            continue;
+        }
+        ost.write(data + start, index - start);
+        start = index + 1;
+        switch (ch) {
+        case '"': ost.write("\\\"", 2); break;
+        case '\\': ost.write("\\\\", 2); break;
+        case '\n': ost.write("\\n", 2); break;
+        case '\r': ost.write("\\r", 2); break;
+        case '\t': ost.write("\\t", 2); break;
+        default: {
+            char buf[6] = {'\\', 'u', '0', '0', kHex[ch >> 4], kHex[ch & 0xf]};
+            ost.write(buf, sizeof(buf));
+            break;
+        }
+        }
+    }
+    ost.write(data + start, size - start);
+    ost.put('"');
+}
+
+void LogChannelJson::format(LogContext::Ptr log, std::ostream &ost) {
+    if (log->env_.level < level_) return;
+
+    auto &env = log->env_;
+    ost.write("{\"ts\":", 6);
+    writeInteger(ost, (uint64_t)env.tv.tv_sec * 1000 + env.tv.tv_usec / 1000, false);
+    ost.write(",\"time\":\"", 9);
+    ost << formatTime(env.tv);
+    ost.write("\",\"level\":\"", 11);
+    ost << strLogLevel(env.level);
+    ost.write("\",\"thread\":", 11);
+    writeString(ost, env.threadName, strlen(env.threadName));
+    ost.write(",\"file\":", 8);
+    writeString(ost, env.file, strlen(env.file));
+    ost.write(",\"func\":", 8);
+    writeString(ost, env.func, strlen(env.func));
+    ost.write(",\"line\":", 8);
+    writeInteger(ost, env.line < 0 ? 0 : env.line, false);
+    ost.write(",\"msg\":", 7);
+    writeString(ost, log->data(), log->size());
+
+    for (size_t index = 0; index < log->fieldCount(); ++index) {
+        auto &field = log->field(index);
+        ost.put(',');
+        writeString(ost, field.key, strlen(field.key));
+        ost.put(':');
+        if (field.type == LogKV::kString) {
+            writeString(ost, log->fieldText(field), field.value.s.size);
+        } else {
+            writeFieldValue(ost, *log, field);
+        }
+    }
+    ost.put('}');
+}
+
+/**
+ * LogContext内存块大小，需要容纳LogContext以及allocate_shared的控制块
+*/
+static constexpr size_t kLogContextBlockSize = (sizeof(LogContext) + 64 + 63) / 64 * 64;
+/**
+ * 线程内缓存与进程级空闲表之间每次转移的内存块数量
+*/
+static constexpr size_t kLogContextBatch = 64;
+/**
+ * 进程级空闲表最多缓存的内存块数量，超过后直接释放
+*/
+static constexpr size_t kLogContextMaxFree = 16 * 1024;
+
+struct LogContextFreeList {
+    std::mutex mutex;
+    std::vector<void *> blocks;
+};//struct LogContextFreeList
+
+static LogContextFreeList &globalFreeList() {
+    //不析构：进程退出时其他线程可能仍在释放LogContext
+    static auto s_list = new LogContextFreeList();
+    return *s_list;
+}
+
+/**
+ * 归还count个内存块到进程级空闲表
+*/
+static void releaseBlocks(std::vector<void *> &blocks, size_t count) {
+    auto &global = globalFreeList();
+    std::lock_guard<std::mutex> lock(global.mutex);
+    for (size_t index = 0; index < count && !blocks.empty(); ++index) {
+        auto ptr = blocks.back();
+        blocks.pop_back();
+        if (global.blocks.size() < kLogContextMaxFree) {
+            global.blocks.push_back(ptr);
+        } else {
+            ::operator delete(ptr);
+        }
+    }
+}
+
+/**
+ * 线程内的空闲内存块缓存
+ *      线程退出后（thread_local析构之后）仍可能释放LogContext，此时localFreeList()返回nullptr，直接使用进程级空闲表
+*/
+static thread_local std::vector<void *> *s_local_free = nullptr;
+static thread_local bool s_local_free_exited = false;
+
+struct LocalFreeListHolder {
+    ~LocalFreeListHolder() {
+        if (s_local_free) {
+            releaseBlocks(*s_local_free, s_local_free->size());
+            delete s_local_free;
+            s_local_free = nullptr;
+        }
+        s_local_free_exited = true;
+    }
+};//struct LocalFreeListHolder
+
+static std::vector<void *> *localFreeList() {
+    if (s_local_free || s_local_free_exited) {
+        return s_local_free;
+    }
+    static thread_local LocalFreeListHolder s_holder;
+    (void)s_holder;
+    s_local_free = new std::vector<void *>();
+    s_local_free->reserve(kLogContextBatch * 2);
+    return s_local_free;
+}
+
+void *LogContextPool::allocate(size_t size) {
+    if (size > kLogContextBlockSize) {
+        return ::operator new(size);
+    }
+
+    auto local = localFreeList();
+    if (local && local->empty()) {
+        //从进程级空闲表批量取回
+        auto &global = globalFreeList();
+        std::lock_guard<std::mutex> lock(global.mutex);
+        auto count = std::min(kLogContextBatch, global.blocks.size());
+        local->insert(local->end(), global.blocks.end() - count, global.blocks.end());
+        global.blocks.resize(global.blocks.size() - count);
+    }
+    if (local && !local->empty()) {
+        auto ptr = local->back();
+        local->pop_back();
+        return ptr;
+    }
+    return ::operator new(kLogContextBlockSize);
+}
+
+void LogContextPool::deallocate(void *ptr, size_t size) {
+    if (size > kLogContextBlockSize) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    auto local = localFreeList();
+    if (!local) {
+        auto &global = globalFreeList();
+        std::lock_guard<std::mutex> lock(global.mutex);
+        if (global.blocks.size() < kLogContextMaxFree) {
+            global.blocks.push_back(ptr);
+        } else {
+            ::operator delete(ptr);
+        }
+        return;
+    }
+    local->push_back(ptr);
+    if (local->size() >= kLogContextBatch * 2) {
+        releaseBlocks(*local, kLogContextBatch);
+    }
 }
 
 Logger& Logger::instance() {
@@ -39,26 +382,110 @@ Logger& Logger::instance() {
 }
 
 
-std::string LogChannel::formatTime(const timeval &tv) {
+const char *LogChannel::formatTime(const timeval &tv) {
     //timeval中tv_sec字段代表time_t（日历时间）
-    time_t sec = tv.tv_sec;
-    auto tm = localtime(&sec);
-
-    std::string format;
-    format.resize(128);
-    if (tm) {
-        int nwritten = snprintf((char *)format.data(), 128, "%d/%02d/%02d %02d:%02d:%02d.%03d",
-            1900 + tm->tm_year,
-            1 + tm->tm_mon,
-            tm->tm_mday,
-            tm->tm_hour,
-            tm->tm_min,
-            tm->tm_sec,
-            (int)(tv.tv_usec / 1000));
-        //format[nwritten] = '\0';
-        format.resize(nwritten);
-    }
-    return std::move(format);
+    if (tv.tv_sec != time_sec_) {
+        time_t sec = tv.tv_sec;
+        struct tm tm;
+#if defined(_WIN32)
+        bool ok = localtime_s(&tm, &sec) == 0;
+#else
+        bool ok = localtime_r(&sec, &tm) != nullptr;
+#endif
+        int nwritten = 0;
+        if (ok) {
+            nwritten = snprintf(time_buf_, sizeof(time_buf_), "%d/%02d/%02d %02d:%02d:%02d.000",
+                1900 + tm.tm_year,
+                1 + tm.tm_mon,
+                tm.tm_mday,
+                tm.tm_hour,
+                tm.tm_min,
+                tm.tm_sec);
+        }
+        if (nwritten < 4 || nwritten >= (int)sizeof(time_buf_)) {
+            time_buf_[0] = '\0';
+            time_len_ = 0;
+            return time_buf_;
+        }
+        time_len_ = nwritten;
+        time_sec_ = sec;
+    }
+    if (!time_len_) {
+        return time_buf_;
+    }
+
+    //只更新毫秒
+    int ms = (int)(tv.tv_usec / 1000);
+    auto pos = time_buf_ + time_len_ - 3;
+    pos[0] = '0' + ms / 100;
+    pos[1] = '0' + ms / 10 % 10;
+    pos[2] = '0' + ms % 10;
+    return time_buf_;
+}
+
+/**
+ * kRate模式补充令牌的最小间隔
+*/
+static constexpr uint64_t kLogLimiterRefillMs = 10;
+/**
+ * 汇总日志的最小间隔
+*/
+static constexpr uint64_t kLogLimiterReportMs = 1000;
+
+LogLimiter::LogLimiter(Mode mode, uint32_t n) : mode_(mode), n_(n ? n : 1), tokens_(n_) {
+    auto now = getMonotonicMillisecond(kClockCoarse);
+    last_refill_ms_ = now;
+    next_refill_ms_ = now + kLogLimiterRefillMs;
+    next_report_ms_ = now;
+}
+
+bool LogLimiter::refillAndTake() {
+    auto now = getMonotonicMillisecond(kClockCoarse);
+    if (now < next_refill_ms_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    refill(now);
+    return takeToken();
+}
+
+void LogLimiter::refill(uint64_t now) {
+    //只有一个线程抢到本次补充
+    auto next = next_refill_ms_.load(std::memory_order_relaxed);
+    if (now < next || !next_refill_ms_.compare_exchange_strong(next, now + kLogLimiterRefillMs, std::memory_order_relaxed)) {
+        return;
+    }
+    //按经过的时间补充令牌，桶容量为每秒的数量
+    auto add = (int64_t)((now - last_refill_ms_.load(std::memory_order_relaxed)) * n_ / 1000);
+    if (add <= 0) {
+        //未满一个令牌，不更新last_refill_ms_，累计到下次补充
+        return;
+    }
+    last_refill_ms_.store(now, std::memory_order_relaxed);
+    auto tokens = tokens_.load(std::memory_order_relaxed);
+    int64_t target;
+    do {
+        target = std::min<int64_t>(std::max<int64_t>(tokens, 0) + add, n_);
+    } while (!tokens_.compare_exchange_weak(tokens, target, std::memory_order_relaxed));
+}
+
+void LogLimiter::report(Logger &logger, int level, const char *file, const char *func, int line) {
+    auto now = getMonotonicMillisecond(kClockCoarse);
+    auto next = next_report_ms_.load(std::memory_order_relaxed);
+    if (now < next || !next_report_ms_.compare_exchange_strong(next, now + kLogLimiterReportMs, std::memory_order_relaxed)) {
+        return;
+    }
+    auto suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    if (!suppressed) {
+        return;
+    }
+    suppressed_total_.fetch_add(suppressed, std::memory_order_relaxed);
+
+    //调用点随后可能读取errno（例如发送失败后判断EAGAIN），写汇总日志不能改变errno
+    auto err = errno;
+    LogContextCapture(logger, level, file, func, line)
+        << "suppressed " << suppressed << " messages ("
+        << (mode_ == kRate ? "rate limit " : "sample 1/") << n_ << (mode_ == kRate ? "/s)" : ")");
+    errno = err;
 }
 
 /**
@@ -76,7 +503,20 @@ void LogContextCaptureWrapper::PrintLogV(Logger& logger, int level, const char*
     //先捕获日志输入上下环境
     LogContextCapture capture(logger, level, file, func, line);
 
-    //通过vasprintf函数，格式化字符串
+    //先格式化到栈上缓冲，超出时再通过vasprintf函数格式化字符串
+    char buf[LogContext::kInlineSize];
+    va_list copy;
+    va_copy(copy, args);
+    int size = vsnprintf(buf, sizeof(buf), fmt, copy);
+    va_end(copy);
+    if (size < 0) {
+      return;
+    }
+    if ((size_t)size < sizeof(buf)) {
+      capture << buf;
+      return;
+    }
+
     char* content = nullptr;
     if (vasprintf(&content, fmt, args) > 0 && content) {
       capture << content;
@@ -84,5 +524,546 @@ void LogContextCaptureWrapper::PrintLogV(Logger& logger, int level, const char*
     }
 }
 
+/**
+ * 文件日志通道的内存块大小，日志缓冲由若干内存块组成
+*/
+static constexpr size_t kLogChunkSize = 64 * 1024;
+/**
+ * 一次writev最多提交的内存块数量
+*/
+static constexpr int kLogMaxIov = 64;
+
+LogChannelFile::ChunkBuffer::ChunkBuffer(size_t chunkSize, size_t chunkCount) : chunk_size_(chunkSize) {
+    reserve(chunkCount);
+    setChunk(0);
+}
+
+size_t LogChannelFile::ChunkBuffer::size() const {
+    return current_ * chunk_size_ + (pptr() - pbase());
+}
+
+void LogChannelFile::ChunkBuffer::clear() {
+    setChunk(0);
+}
+
+void LogChannelFile::ChunkBuffer::reserve(size_t chunkCount) {
+    while (chunks_.size() < chunkCount) {
+        chunks_.emplace_back(new char[chunk_size_]);
+    }
+}
+
+size_t LogChannelFile::ChunkBuffer::chunkCount() const {
+    //切换内存块只发生在写入字符时，所以当前块之前的内存块都是满的
+    return current_ + (pptr() != pbase() ? 1 : 0);
+}
+
+const char *LogChannelFile::ChunkBuffer::chunkData(size_t index) const {
+    return chunks_[index].get();
+}
+
+size_t LogChannelFile::ChunkBuffer::chunkSize(size_t index) const {
+    return index < current_ ? chunk_size_ : pptr() - pbase();
+}
+
+LogChannelFile::ChunkBuffer::int_type LogChannelFile::ChunkBuffer::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    //当前内存块已写满，切换到下一块（不足时才申请内存）
+    setChunk(current_ + 1);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+void LogChannelFile::ChunkBuffer::setChunk(size_t index) {
+    reserve(index + 1);
+    current_ = index;
+    auto data = chunks_[index].get();
+    setp(data, data + chunk_size_);
+}
+
+LogChannelFile::LogChannelFile(const std::string &dir, const std::string &prefix, size_t maxFileSize)
+    : dir_(dir.empty() ? "." : dir),
+      prefix_(prefix),
+      max_file_size_(maxFileSize),
+      buffer_size_(1024 * 1024),
+      buffer_(kLogChunkSize, buffer_size_ / kLogChunkSize + 1),
+      stream_(&buffer_) {
+
+}
+
+LogChannelFile::~LogChannelFile() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_l();
+    closeFile();
+}
+
+void LogChannelFile::writeLog(LogContext::Ptr log) {
+    if (log->env_.level < level_) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    //按日志时间切换日期，按文件大小切换序号
+    time_t sec = log->env_.tv.tv_sec;
+    if (fd_ < 0 || sec >= next_day_sec_ || file_size_ + buffer_.size() >= max_file_size_) {
+        flush_l();
+        openFile(sec);
+    }
+
+    format(log, stream_);
+    stream_ << '\n';
+
+    if (buffer_.size() >= buffer_size_) {
+        flush_l();
+    }
+}
+
+void LogChannelFile::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_l();
+}
+
+void LogChannelFile::setBufferSize(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_l();
+    buffer_size_ = size;
+    buffer_.reserve(size / kLogChunkSize + 1);
+}
+
+void LogChannelFile::setPreallocateSize(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    preallocate_size_ = size;
+}
+
+void LogChannelFile::setSyncInterval(int intervalMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sync_interval_ms_ = intervalMs;
+}
+
+std::string LogChannelFile::currentPath() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return path_;
+}
+
+void LogChannelFile::flush_l() {
+    if (buffer_.size() == 0) return;
+
+    writeBuffer();
+    buffer_.clear();
+
+    if (dirty_ && sync_interval_ms_ >= 0) {
+        auto now = getCurrentMillisecond();
+        if (now - last_sync_ms_ >= (uint64_t)sync_interval_ms_) {
+#if defined(_WIN32)
+            _commit(fd_);
+#elif defined(__linux__)
+            fdatasync(fd_);
+#else
+            fsync(fd_);
+#endif
+            last_sync_ms_ = now;
+            dirty_ = false;
+        }
+    }
+}
+
+static void makeLogDir(const std::string &dir) {
+    //逐级创建目录，已存在时mkdir失败，忽略即可
+    for (size_t pos = dir.find_first_of("/\\", 1); ; pos = dir.find_first_of("/\\", pos + 1)) {
+        auto sub = dir.substr(0, pos);
+#if defined(_WIN32)
+        _mkdir(sub.data());
+#else
+        mkdir(sub.data(), 0755);
+#endif
+        if (pos == std::string::npos) break;
+    }
+}
+
+void LogChannelFile::openFile(time_t sec) {
+    bool rotateBySize = fd_ >= 0 && file_size_ >= max_file_size_;
+    closeFile();
+
+    struct tm tm;
+#if defined(_WIN32)
+    localtime_s(&tm, &sec);
+#else
+    localtime_r(&sec, &tm);
+#endif
+    char date[32];
+    snprintf(date, sizeof(date), "%d-%02d-%02d", 1900 + tm.tm_year, 1 + tm.tm_mon, tm.tm_mday);
+    if (date_ != date) {
+        date_ = date;
+        index_ = 0;
+        //下一天零点
+        tm.tm_mday += 1;
+        tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+        tm.tm_isdst = -1;
+        next_day_sec_ = mktime(&tm);
+    } else if (rotateBySize) {
+        ++index_;
+    }
+
+    makeLogDir(dir_);
+    while (true) {
+        path_ = dir_ + "/" + prefix_ + "_" + date_ + "_" + std::to_string(index_) + suffix_;
+        //进程重启后继续写入未写满的文件，跳过已写满的文件
+        struct stat st;
+        file_size_ = stat(path_.data(), &st) == 0 ? st.st_size : 0;
+        if (file_size_ < max_file_size_) break;
+        ++index_;
+    }
+
+#if defined(_WIN32)
+    fd_ = _open(path_.data(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    fd_ = open(path_.data(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    if (fd_ < 0) {
+        std::cerr << "open log file failed: " << path_ << ", " << strerror(errno) << std::endl;
+        return;
+    }
+    allocated_size_ = file_size_;
+}
+
+void LogChannelFile::closeFile() {
+    if (fd_ < 0) return;
+#if defined(_WIN32)
+    if (dirty_) _commit(fd_);
+    _close(fd_);
+#else
+    if (allocated_size_ > file_size_) {
+        //释放预分配但未使用的空间
+        if (ftruncate(fd_, file_size_) != 0) {}
+    }
+    if (dirty_) fsync(fd_);
+    close(fd_);
+#endif
+    fd_ = -1;
+    dirty_ = false;
+}
+
+void LogChannelFile::preallocate() {
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    auto need = file_size_ + buffer_.size();
+    if (!preallocate_size_ || need <= allocated_size_) return;
+
+    auto size = std::max(need, allocated_size_) + preallocate_size_;
+    //KEEP_SIZE：只分配磁盘空间，不改变文件长度，O_APPEND写入位置不受影响
+    if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocated_size_, size - allocated_size_) != 0) {
+        //文件系统不支持时不再尝试
+        preallocate_size_ = 0;
+        return;
+    }
+    allocated_size_ = size;
+#endif
+}
+
+int LogChannelFile::writeBuffer() {
+    if (fd_ < 0) return -1;
+    preallocate();
+
+    size_t count = buffer_.chunkCount();
+    size_t total = 0;
+#if defined(_WIN32)
+    for (size_t index = 0; index < count; ++index) {
+        auto data = buffer_.chunkData(index);
+        auto left = buffer_.chunkSize(index);
+        while (left > 0) {
+            auto ret = _write(fd_, data, (unsigned)left);
+            if (ret <= 0) return -1;
+            data += ret;
+            left -= ret;
+            total += ret;
+        }
+    }
+#else
+    struct iovec iov[kLogMaxIov];
+    size_t index = 0;
+    while (index < count) {
+        int iovcnt = 0;
+        for (size_t i = index; i < count && iovcnt < kLogMaxIov; ++i, ++iovcnt) {
+            iov[iovcnt].iov_base = (void *)buffer_.chunkData(i);
+            iov[iovcnt].iov_len = buffer_.chunkSize(i);
+        }
+        index += iovcnt;
+
+        //处理部分写入：跳过已写出的iovec后继续
+        struct iovec *pos = iov;
+        while (iovcnt > 0) {
+            auto ret = writev(fd_, pos, iovcnt);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                file_size_ += total;
+                return -1;
+            }
+            total += ret;
+            while (iovcnt > 0 && (size_t)ret >= pos->iov_len) {
+                ret -= pos->iov_len;
+                ++pos;
+                --iovcnt;
+            }
+            if (iovcnt > 0) {
+                pos->iov_base = (char *)pos->iov_base + ret;
+                pos->iov_len -= ret;
+            }
+        }
+    }
+#endif
+    file_size_ += total;
+    dirty_ = true;
+    return (int)total;
+}
+
+/**
+ * 单个写日志线程的SPSC环形队列
+ *      写日志线程（生产者）只修改tail，AsyncLogWriter线程（消费者）只修改head
+ *  溢出队列：环形队列写满后日志写入spill（kOverflowSpill），spilling置位期间该线程的日志都写入spill
+ *      AsyncLogWriter线程先取完环形队列（其中的日志都早于spill），再在spill_mutex下取出spill并复位spilling，
+ *      结束本次溢出：此后该线程的日志重新写入（已被取空的）环形队列，都晚于取出的spill，同一线程日志的顺序不变
+*/
+struct AsyncLogWriter::StageRing {
+    explicit StageRing(size_t size) : slots(size), mask(size - 1), head(0), tail(0), spilling(false), detached(false) {}
+
+    bool empty() const {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+
+    bool tryPush(LogContext::Ptr &log, Logger *logger) {
+        auto pos = tail.load(std::memory_order_relaxed);
+        if (pos - head.load(std::memory_order_acquire) >= slots.size()) {
+            return false;
+        }
+        auto &slot = slots[pos & mask];
+        slot.first = std::move(log);
+        slot.second = logger;
+        tail.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * 取出当前队列中的所有日志
+    */
+    void popAll(std::vector<Record> &out) {
+        auto pos = head.load(std::memory_order_relaxed);
+        auto end = tail.load(std::memory_order_acquire);
+        for (; pos != end; ++pos) {
+            out.emplace_back(std::move(slots[pos & mask]));
+        }
+        head.store(pos, std::memory_order_release);
+    }
+
+    std::vector<Record> slots;
+    const size_t mask;
+    //head与tail分别由不同线程修改，避免在同一cache line
+    char pad0[64];
+    std::atomic<size_t> head;
+    char pad1[64];
+    std::atomic<size_t> tail;
+    char pad2[64];
+
+    std::mutex spill_mutex;
+    std::vector<Record> spill;
+    std::atomic<bool> spilling;
+    std::atomic<bool> detached;//写日志线程已退出
+};//struct AsyncLogWriter::StageRing
+
+/**
+ * 线程注册的环形队列，线程退出时标记detached，由AsyncLogWriter线程取完日志后移除
+*/
+struct ThreadStageRings {
+    struct Node {
+        uint64_t id;//AsyncLogWriter::id_
+        std::shared_ptr<void> ring;
+        std::atomic<bool> *detached;
+    };
+    std::vector<Node> rings;
+
+    ~ThreadStageRings() {
+        for (auto &node : rings) {
+            node.detached->store(true, std::memory_order_release);
+        }
+    }
+};//struct ThreadStageRings
+
+static thread_local ThreadStageRings s_stage_rings;
+static std::atomic<uint64_t> s_async_writer_id(0);
+
+static size_t roundUpPowerOf2(size_t size) {
+    size_t ret = 2;
+    while (ret < size) ret <<= 1;
+    return ret;
+}
+
+AsyncLogWriter::AsyncLogWriter(OverflowPolicy policy, size_t ringSize)
+    : id_(++s_async_writer_id),
+      ring_size_(roundUpPowerOf2(ringSize)),
+      policy_(policy),
+      dropped_(0),
+      spilled_(0),
+      rings_changed_(false),
+      sleeping_(false),
+      exit_(false) {
+    thread_ = std::make_shared<std::thread>([this]()->void { this->run(); });
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    exit();
+}
+
+AsyncLogWriter::StageRing *AsyncLogWriter::getRing() {
+    auto &rings = s_stage_rings.rings;
+    for (auto &node : rings) {
+        if (node.id == id_) {
+            return (StageRing *)node.ring.get();
+        }
+    }
+    //清理已销毁的AsyncLogWriter的环形队列（只剩当前线程引用）
+    for (auto it = rings.begin(); it != rings.end();) {
+        it = it->ring.use_count() == 1 ? rings.erase(it) : it + 1;
+    }
+
+    //当前线程首次通过该AsyncLogWriter写日志，注册环形队列
+    auto ring = std::make_shared<StageRing>(ring_size_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.emplace_back(ring);
+        rings_changed_ = true;
+    }
+    rings.push_back({id_, ring, &ring->detached});
+    return ring.get();
+}
+
+void AsyncLogWriter::writeLog(LogContext::Ptr log, Logger &logger) {
+    auto ring = getRing();
+    if (!ring->spilling.load(std::memory_order_acquire) && ring->tryPush(log, &logger)) {
+        wakeup();
+        return;
+    }
+
+    auto policy = policy_.load(std::memory_order_relaxed);
+    if (policy == kOverflowDrop) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    //kOverflowBlock：切换策略前已有溢出的日志时，仍写入溢出队列以保证顺序
+    if (policy == kOverflowBlock && !ring->spilling.load(std::memory_order_acquire)) {
+        while (!ring->tryPush(log, &logger)) {
+            if (exit_) return;
+            wakeup();
+            std::this_thread::yield();
+        }
+        wakeup();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(ring->spill_mutex);
+        ring->spilling.store(true, std::memory_order_release);
+        ring->spill.emplace_back(std::move(log), &logger);
+        spilled_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wakeup();
+}
+
+void AsyncLogWriter::wakeup() {
+    /**
+     * 与run()中sleeping_置位后再次检查队列配对：
+     *      要么AsyncLogWriter线程检查到新写入的日志，要么写日志线程看到sleeping_并唤醒它
+    */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) {
+        semphore_.post();
+    }
+}
+
+void AsyncLogWriter::run() {
+    util::setThreadName("AsyncLogWriter");
+    while (!exit_) {
+        if (drain()) continue;
+
+        sleeping_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (drain() || exit_) {
+            //可能已被唤醒，多出的信号量只会导致一次空的drain
+            sleeping_.store(false);
+            continue;
+        }
+        semphore_.wait();
+    }
+    //退出前写完剩余日志
+    drain();
+}
+
+bool AsyncLogWriter::drain() {
+    if (rings_changed_.exchange(false)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        draining_ = rings_;
+    }
+
+    bool removed = false;
+    for (auto &ring : draining_) {
+        //spilling置位期间该线程不会写入环形队列，环形队列中的日志都早于spill中的日志
+        bool spilling = ring->spilling.load(std::memory_order_acquire);
+        ring->popAll(batch_);
+        if (spilling) {
+            {
+                //取出spill的同时结束本次溢出，写日志线程回到无锁的环形队列
+                std::lock_guard<std::mutex> lock(ring->spill_mutex);
+                spill_.swap(ring->spill);
+                ring->spilling.store(false, std::memory_order_release);
+            }
+            for (auto &record : spill_) {
+                batch_.emplace_back(std::move(record));
+            }
+            spill_.clear();
+        }
+        if (ring->detached.load(std::memory_order_acquire) && ring->empty() && !ring->spilling) {
+            removed = true;
+        }
+    }
+
+    if (removed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = rings_.begin(); it != rings_.end();) {
+            if ((*it)->detached && (*it)->empty() && !(*it)->spilling) {
+                it = rings_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        rings_changed_ = true;
+    }
+
+    if (batch_.empty()) return false;
+    writeBatch();
+    return true;
+}
+
+void AsyncLogWriter::writeBatch() {
+    Logger *logger = nullptr;
+    for (auto &record : batch_) {
+        //一批日志写完后再flush通道（通常只有一个Logger）
+        if (logger && logger != record.second) {
+            logger->flushChannels();
+        }
+        logger = record.second;
+        logger->writeLogToChannels(record.first);
+    }
+    if (logger) {
+        logger->flushChannels();
+    }
+    batch_.clear();
+}
+
+void AsyncLogWriter::exit() {
+    exit_ = true;
+    sleeping_ = false;
+    semphore_.post();
+
+    thread_->join();
+    thread_.reset();
+}
+
 }//namespace util
 }
\ No newline at end of file
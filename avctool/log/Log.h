@@ -6,6 +6,12 @@
 #include <vector>
 #include <thread>
 #include <sstream>//使用std::ostringstream
+#include <streambuf>//文件日志通道的内存缓冲
+#include <mutex>
+#include <atomic>
+#include <tuple>
+#include <type_traits>
+#include <string.h>
 
 #include <iostream>//控制台日志通道
 
@@ -42,22 +48,97 @@ struct LogContextCapture;
 class Logger;
 
 
+/**
+ * LogContext内存池
+ *      LogContext与shared_ptr控制块通过allocate_shared分配在同一内存块中，内存块大小固定，
+ *      释放后缓存在线程内（批量归还到进程级的空闲表），稳定运行后创建LogContext不申请内存
+ *      异步写日志时LogContext在写日志线程分配、在AsyncLogWriter线程释放，内存块经进程级空闲表回到写日志线程
+*/
+struct LogContextPool {
+    static void *allocate(size_t size);
+    static void deallocate(void *ptr, size_t size);
+};//struct LogContextPool
+
+template<class T>
+struct LogContextAllocator {
+    using value_type = T;
+
+    LogContextAllocator() = default;
+    template<class U>
+    LogContextAllocator(const LogContextAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return (T *)LogContextPool::allocate(n * sizeof(T));
+    }
+    void deallocate(T *ptr, size_t n) {
+        LogContextPool::deallocate(ptr, n * sizeof(T));
+    }
+
+    template<class U>
+    bool operator==(const LogContextAllocator<U> &) const { return true; }
+    template<class U>
+    bool operator!=(const LogContextAllocator<U> &) const { return false; }
+};//struct LogContextAllocator
+
+/**
+ * 结构化日志字段：通过operator<<附加到日志上，不写入日志正文
+ *      WarnL << "sendto failed" << LogKV("peer", ip) << LogKV("errno", err);
+ *  key需要是字符串字面量（只保存指针），字符串值在附加时拷贝
+*/
+struct LogKV {
+    enum Type : uint8_t {
+        kInt,
+        kUint,
+        kDouble,
+        kBool,
+        kString,
+    };//enum Type
+
+    template<class T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    LogKV(const char *key, T value) : key(key), type(kInt) { this->value.i = value; }
+    template<class T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, int>::type = 0>
+    LogKV(const char *key, T value) : key(key), type(kUint) { this->value.u = value; }
+    template<class T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+    LogKV(const char *key, T value) : key(key), type(kDouble) { this->value.d = value; }
+    LogKV(const char *key, bool value) : key(key), type(kBool) { this->value.b = value; }
+    LogKV(const char *key, const char *value) : key(key), type(kString), str(value ? value : ""), size(strlen(str)) {}
+    LogKV(const char *key, const std::string &value) : key(key), type(kString), str(value.data()), size(value.size()) {}
+
+    const char *key;
+    Type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        bool b;
+    } value;
+    const char *str = nullptr;
+    size_t size = 0;
+};//struct LogKV
+
 /**
  * LogContext日志上下文，负责C++流式格式化输入日志正文参数
- *    通过std::ostringstream，实现operator<<流式输入
+ *    通过std::ostream实现operator<<流式输入，日志正文格式化到LogContext内部的固定缓冲中，
+ *    超过kInlineSize的长日志才转存到堆上
 */
-struct LogContext : public std::ostringstream
+struct LogContext : public std::ostream
 {
     using Ptr = std::shared_ptr<LogContext>;
     using Content = std::string;
+    /**
+     * 日志正文内部缓冲大小，覆盖绝大多数日志
+    */
+    static constexpr size_t kInlineSize = 256;
     
     LogContext();
     LogContext(int level, const char *file, const char* func, int line);
+    LogContext(const LogContext &) = delete;
+    LogContext &operator=(const LogContext &) = delete;
 
     template<typename ...ARGS>
     static Ptr create(ARGS&& ...args) {
-      //对每个arg参数进行std::forward展开
-      return std::make_shared<LogContext>(std::forward<ARGS>(args)...);
+      //对每个arg参数进行std::forward展开，从内存池分配
+      return std::allocate_shared<LogContext>(LogContextAllocator<LogContext>(), std::forward<ARGS>(args)...);
     }
 
     /**
@@ -75,28 +156,139 @@ struct LogContext : public std::ostringstream
       *   timeval保存秒以及微秒
       */
       struct timeval tv;//日志打印时间
-      std::string threadName;//线程名称
+      const char *threadName;//线程名称，指向getThreadNameCached()驻留的名称，跨线程有效
     };//struct Env
 
-    const Content& content() {
-      if (gotContent_) {
-        return content_;
-      }
-      content_ = str();
-      return content_;
+    /**
+     * 已格式化的日志正文（不以'\0'结尾）
+    */
+    const char *data() const {
+      resolve();
+      return buf_.data();
+    }
+    size_t size() const {
+      resolve();
+      return buf_.size();
+    }
+
+    /**
+     * 延迟格式化（见DeferL）：正文缓冲中保存的是编码后的原始参数，
+     * 第一次读取正文时（通常在AsyncLogWriter线程）由decoder按fmt格式化，替换正文缓冲的内容
+    */
+    using Decoder = void (*)(LogContext &log, const char *fmt, const char *raw, size_t size);
+    void setDeferred(const char *fmt, Decoder decoder) {
+      deferred_fmt_ = fmt;
+      decoder_ = decoder;
+    }
+    /**
+     * 直接写入正文缓冲，不经过std::ostream的格式化
+    */
+    void append(const char *data, size_t size) {
+      buf_.sputn(data, size);
+    }
+
+    /**
+     * 结构化字段，字符串值保存在fields_text_中
+    */
+    struct Field {
+      const char *key;
+      LogKV::Type type;
+      union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        bool b;
+        struct {
+          uint32_t offset;
+          uint32_t size;
+        } s;
+      } value;
+    };//struct Field
+    static constexpr size_t kMaxFields = 8;
+
+    /**
+     * 附加结构化字段，超过kMaxFields的字段被忽略
+    */
+    void addField(const LogKV &kv);
+
+    size_t fieldCount() const {
+      return field_count_;
+    }
+    const Field &field(size_t index) const {
+      return fields_[index];
+    }
+    const char *fieldText(const Field &field) const {
+      return fields_text_.data() + field.value.s.offset;
+    }
+
+    /**
+     * 拷贝日志正文，日志通道输出时应使用data()/size()
+    */
+    Content str() const {
+      return Content(data(), size());
+    }
+    Content content() const {
+      return str();
     }
 
     /**
      * 日志的上下文环境
     */
     Env env_;
+private:
     /**
-     * 已格式化的日志正文
+     * 日志正文缓冲：先使用内部固定缓冲，写满后转存到std::string中按倍数扩容
     */
-    Content content_;
-    bool gotContent_ = false;
+    class ContentBuf : public std::streambuf {
+    public:
+        ContentBuf() {
+            setp(inline_, inline_ + kInlineSize);
+        }
+        const char *data() const {
+            return pbase();
+        }
+        size_t size() const {
+            return pptr() - pbase();
+        }
+        void clear() {
+            pbump(-(int)size());
+        }
+    protected:
+        int_type overflow(int_type ch) override;
+    private:
+        char inline_[kInlineSize];
+        std::string heap_;
+    };//class ContentBuf
+
+    void resolve() const {
+        if (decoder_) {
+            const_cast<LogContext *>(this)->resolveDeferred();
+        }
+    }
+    void resolveDeferred();
+private:
+    ContentBuf buf_;
+    const char *deferred_fmt_ = nullptr;
+    Decoder decoder_ = nullptr;
+
+    size_t field_count_ = 0;
+    Field fields_[kMaxFields];
+    ContentBuf fields_text_;
 };//struct LogContext
 
+/**
+ * 通过operator<<附加结构化字段：*log << LogKV("bytes", n)
+*/
+inline LogContext &operator<<(LogContext &log, const LogKV &kv) {
+    log.addField(kv);
+    return log;
+}
+/**
+ * *log << "text" << LogKV(...)：前一个<<返回的是std::ostream
+ *      是LogContext时附加字段，否则以 key=value 输出
+*/
+std::ostream &operator<<(std::ostream &ost, const LogKV &kv);
+
 /**
  * @brief 写日志接口
 */
@@ -117,6 +309,11 @@ public:
     virtual ~LogChannel() {}
 
     virtual void writeLog(LogContext::Ptr log) = 0;
+    /**
+     * 将通道内部缓冲的日志写出
+     *      同步写日志时每条日志后调用；AsyncLogWriter每处理完一批日志后调用
+    */
+    virtual void flush() {}
 
     void setLevel(int level) {
       level_ = level;
@@ -130,12 +327,23 @@ protected:
         ost << "[" << log->env_.func << ":" << log->env_.line
           << " " << log->env_.threadName << "][" << strLogLevel(log->env_.level) << "]: ";
         //输出日志正文
-        ost << log->content();
+        ost.write(log->data(), log->size());
+        //结构化字段以 key=value 追加在正文后
+        formatFields(log, ost);
     }
-private:
-    static std::string formatTime(const timeval &time);
-private:
+    static void formatFields(const LogContext::Ptr &log, std::ostream &ost);
+    /**
+     * 格式化日志时间："YYYY/MM/DD HH:MM:SS.mmm"
+     *      同一秒内复用已格式化的日期时间，只更新毫秒，换秒时才调用localtime_r
+     *      返回的指针在下一次调用前有效；同一通道的format需要串行调用（通道内加锁）
+    */
+    const char *formatTime(const timeval &tv);
+protected:
     int level_ = LogLevel::kLogLevelTrace;//日志级别
+private:
+    time_t time_sec_ = -1;//time_buf_对应的秒
+    size_t time_len_ = 0;
+    char time_buf_[32] = {0};
 };//class LogChannel
 
 /**
@@ -148,19 +356,135 @@ public:
   virtual ~LogChannelConsole()  {}
 
   void writeLog(LogContext::Ptr log) override {
+    //同步写日志时可能被多个线程同时调用，加锁保证时间缓存与整行输出不交错
+    std::lock_guard<std::mutex> lock(mutex_);
     format(log, std::cout);
     //标准输出I/O，控制台是行缓冲，通过std::endl冲洗缓冲区
     std::cout << std::endl;
   }
+private:
+  std::mutex mutex_;
 };//class LogChannelConsole
 
 /**
  * 文件日志输出通道
+ *      (1) 日志格式化到预分配的内存块中，flush时通过writev一次写入所有内存块，不逐行写文件
+ *      (2) 按天、按大小切分文件：<dir>/<prefix>_<YYYY-MM-DD>_<index>.log
+ *      (3) 可选通过fallocate预分配文件空间，减少追加写入时文件系统分配空间的开销
+ *      (4) fdatasync按时间间隔批量执行
+ *  通常与AsyncLogWriter配合使用：AsyncLogWriter每处理完一批日志调用一次flush
 */
 class LogChannelFile : public LogChannel {
+public:
+    /**
+     * @param dir 日志目录，不存在时自动创建
+     * @param prefix 日志文件名前缀
+     * @param maxFileSize 单个日志文件大小上限，超过后切换到下一个文件
+    */
+    LogChannelFile(const std::string &dir = "./log", const std::string &prefix = "avc",
+                   size_t maxFileSize = 128 * 1024 * 1024);
+    ~LogChannelFile() override;
+
+    void writeLog(LogContext::Ptr log) override;
+    void flush() override;
+
+    /**
+     * 内存缓冲大小，缓冲的日志超过该大小时立即写入文件（不等待flush）
+    */
+    void setBufferSize(size_t size);
+    /**
+     * 每次预分配的文件空间大小，0表示不预分配（仅Linux有效）
+    */
+    void setPreallocateSize(size_t size);
+    /**
+     * fdatasync间隔，单位毫秒：0表示每次写入后都执行，小于0表示不执行
+    */
+    void setSyncInterval(int intervalMs);
+
+    /**
+     * 当前写入的日志文件路径
+    */
+    std::string currentPath();
+protected:
+    std::string suffix_ = ".log";//日志文件扩展名，子类可在构造时修改
+private:
+    /**
+     * 由多个固定大小内存块组成的输出缓冲，作为std::ostream的streambuf使用
+     *      内存块预先分配并重复使用，写满一块后切换到下一块，稳定运行后不再申请内存
+    */
+    class ChunkBuffer : public std::streambuf {
+    public:
+        ChunkBuffer(size_t chunkSize, size_t chunkCount);
+
+        size_t size() const;
+        void clear();
+        void reserve(size_t chunkCount);
 
+        /**
+         * 已写入数据的内存块数量，以及每个内存块中的数据
+        */
+        size_t chunkCount() const;
+        const char *chunkData(size_t index) const;
+        size_t chunkSize(size_t index) const;
+    protected:
+        int_type overflow(int_type ch) override;
+    private:
+        void setChunk(size_t index);
+    private:
+        size_t chunk_size_;
+        size_t current_ = 0;
+        std::vector<std::unique_ptr<char[]>> chunks_;
+    };//class ChunkBuffer
+
+    void flush_l();
+    void openFile(time_t sec);
+    void closeFile();
+    int writeBuffer();
+    void preallocate();
+private:
+    std::string dir_;
+    std::string prefix_;
+    size_t max_file_size_;
+    size_t buffer_size_;
+    size_t preallocate_size_ = 0;
+    int sync_interval_ms_ = 1000;
+
+    std::mutex mutex_;
+    ChunkBuffer buffer_;
+    std::ostream stream_;
+
+    int fd_ = -1;
+    std::string path_;
+    std::string date_;//当前日志文件日期
+    int index_ = 0;//当前日期下的文件序号
+    time_t next_day_sec_ = 0;//下一天开始的时间，日志时间超过时切换文件
+    size_t file_size_ = 0;
+    size_t allocated_size_ = 0;//已预分配的文件大小
+    uint64_t last_sync_ms_ = 0;
+    bool dirty_ = false;//是否有写入但未fdatasync的数据
 };//class LogChannelFile
 
+/**
+ * JSON Lines文件日志输出通道：每条日志一行JSON对象，便于日志检索系统直接导入
+ *      {"ts":1760794441057,"time":"2026/10/18 21:34:01.057","level":"Warn","thread":"...",
+ *       "file":"...","func":"...","line":55,"msg":"...","peer":"1.2.3.4","errno":111}
+ *  复用LogChannelFile的缓冲、切分与落盘逻辑，直接序列化到缓冲中，不拼接中间字符串
+*/
+class LogChannelJson : public LogChannelFile {
+public:
+    LogChannelJson(const std::string &dir = "./log", const std::string &prefix = "avc",
+                   size_t maxFileSize = 128 * 1024 * 1024)
+        : LogChannelFile(dir, prefix, maxFileSize) {
+        suffix_ = ".jsonl";
+    }
+protected:
+    void format(LogContext::Ptr log, std::ostream &ost) override;
+    /**
+     * 写入JSON字符串（含引号），转义引号、反斜杠与控制字符
+    */
+    static void writeString(std::ostream &ost, const char *data, size_t size);
+};//class LogChannelJson
+
 /**
  * Logger设计成全局静态变量
 */
@@ -168,6 +492,14 @@ class Logger {
 public:
     static Logger &instance();
 
+    ~Logger() {
+        /**
+         * 先停止writer：AsyncLogWriter线程退出前会写完剩余日志，
+         * 此时channels_必须仍然有效（成员按声明逆序析构，channels_会先于writer_析构）
+        */
+        writer_.reset();
+    }
+
     /**
      * 添加日志输出通道
     */
@@ -175,6 +507,20 @@ public:
       channels_.emplace_back(logChannel);
     }
  
+    /**
+     * 设置最低日志级别，低于该级别的日志在创建LogContext之前被过滤（不格式化也不进入writer）
+     *      日志宏在每次写日志时读取，修改后立即对所有线程生效
+    */
+    void setLevel(int level) {
+      level_.store(level, std::memory_order_relaxed);
+    }
+    int level() const {
+      return level_.load(std::memory_order_relaxed);
+    }
+    bool enabled(int level) const {
+      return level >= level_.load(std::memory_order_relaxed);
+    }
+
     /**
      * 设置日志writer,默认情况同步写日志
      *      一般用于设置异步日志Writer
@@ -188,6 +534,7 @@ public:
             return writer_->writeLog(log, *this);
         }
         writeLogToChannels(log);
+        flushChannels();
     }
     
     void writeLogToChannels(LogContext::Ptr log) {
@@ -195,78 +542,97 @@ public:
         node->writeLog(log);
       }
     }
+
+    void flushChannels() {
+      for (auto& node : channels_) {
+        node->flush();
+      }
+    }
 private:
+    std::atomic<int> level_{LogLevel::kLogLevelTrace};
     LogWriter::Ptr writer_;
 
     std::vector<LogChannel::Ptr> channels_;
 };//class Logger
 
+/**
+ * 异步日志Writer
+ *      每个写日志的线程首次写日志时注册一个独立的SPSC环形队列，之后写日志不加锁，
+ *      AsyncLogWriter线程轮流取出各线程队列中的日志写入Logger的日志通道
+ *      同一线程的日志保持顺序，不同线程之间的日志不保证严格按时间顺序
+ *  环形队列写满时按OverflowPolicy处理
+*/
 class AsyncLogWriter : public LogWriter {
 public:
-    AsyncLogWriter() {
-      exit_ = false;
-      thread_ = std::make_shared<std::thread>([this]()->void { this->run(); });
-    }
-
-    ~AsyncLogWriter() {
-        exit();
-    }
-    
     /**
-     * @brief writeLog时，指定依赖的Logger
+     * 线程环形队列写满时的处理策略
     */
-    void writeLog(LogContext::Ptr log, Logger &logger) override {
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            pendding_.push_back(std::make_pair(log, &logger));
-        }
-        semphore_.post();
-    }
-private:
-    void run() {
-        util::setThreadName("AsyncLogWriter");
-        while(!exit_) {
-            semphore_.wait();
+    enum OverflowPolicy {
+        kOverflowBlock,//等待AsyncLogWriter线程取出日志后再写入
+        kOverflowDrop,//丢弃日志，通过droppedCount()查询丢弃数量
+        kOverflowSpill,//写入该线程加锁的溢出队列，不丢失也不阻塞
+    };//enum OverflowPolicy
 
-            decltype(pendding_) tmp;
-            {
-                std::unique_lock<std::mutex> lock(mutex_);
-                if (pendding_.empty()) continue;
+    /**
+     * @param policy 环形队列写满时的处理策略
+     * @param ringSize 每个线程环形队列的大小，向上取整为2的幂
+    */
+    AsyncLogWriter(OverflowPolicy policy = kOverflowSpill, size_t ringSize = 1024);
+    ~AsyncLogWriter();
 
-                pendding_.swap(tmp);
-            }
+    /**
+     * @brief writeLog时，指定依赖的Logger
+    */
+    void writeLog(LogContext::Ptr log, Logger &logger) override;
 
-            for (auto &node : tmp) {
-                node.second->writeLogToChannels(node.first);
-            }
-        }
+    void setOverflowPolicy(OverflowPolicy policy) {
+        policy_ = policy;
     }
-
-    void exit() {
-      /**
-       * exit_变量有多线程访问的情形。
-       *     冲突发生场景：其他线程调用exit退出, 对run线程退出条件判断没什么影响
-       *     因此不需要加锁
-      */
-      exit_ = true;
-      semphore_.post();
-
-      thread_->join();
-      thread_.reset();
+    uint64_t droppedCount() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+    uint64_t spilledCount() const {
+        return spilled_.load(std::memory_order_relaxed);
     }
 private:
-    std::mutex mutex_;
-    std::vector<std::pair<LogContext::Ptr, Logger *>> pendding_;
+    using Record = std::pair<LogContext::Ptr, Logger *>;
+    struct StageRing;
+
+    StageRing *getRing();
+    void wakeup();
+    void run();
+    bool drain();
+    void writeBatch();
+    void exit();
+private:
+    const uint64_t id_;//区分AsyncLogWriter实例，线程通过id_查找自己的环形队列
+    size_t ring_size_;
+    std::atomic<int> policy_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> spilled_;
+
+    std::mutex mutex_;//保护rings_，仅在线程注册/注销环形队列时加锁
+    std::vector<std::shared_ptr<StageRing>> rings_;
+    std::atomic<bool> rings_changed_;
+
+    //以下变量仅在AsyncLogWriter线程中访问
+    std::vector<std::shared_ptr<StageRing>> draining_;
+    std::vector<Record> batch_;
+    std::vector<Record> spill_;
 
     util::Semphore semphore_;
-    bool exit_ = false;//exit_变量需要加锁吗 ?
+    std::atomic<bool> sleeping_;//AsyncLogWriter线程即将等待，写日志线程需要唤醒
+    std::atomic<bool> exit_;
     std::shared_ptr<std::thread> thread_;
 };//class AsyncLogWriter
 
 /***/
 struct LogContextCapture { 
     LogContextCapture(Logger &logger, int level, const char *file, const char *func, int line) : logger_(logger) {
-        context_ = LogContext::create(level, file, func, line);
+        //低于Logger最低级别时不创建LogContext，后续输入与写入都是空操作
+        if (logger.enabled(level)) {
+            context_ = LogContext::create(level, file, func, line);
+        }
     }
     /**
      * 通过栈变量，捕获日志上下文。当变量析构时，触发写入日志
@@ -319,22 +685,273 @@ struct LogContextCaptureWrapper {
     static void PrintLogV(Logger& logger, int level, const char* file, const char* func, int line, const char* fmt, va_list args);
 };
 
+/**
+ * 延迟格式化日志（DeferL）
+ *      写日志线程只把参数按类型编码到LogContext的正文缓冲中，不调用snprintf，
+ *      格式化推迟到第一次读取正文时（异步写日志时在AsyncLogWriter线程）
+ *  支持的参数：整数、浮点数、枚举、C字符串（编码时拷贝）、指针；fmt必须是字符串字面量
+*/
+struct LogDeferred {
+    /**
+     * 参数编码后的类型：按可变参数的默认提升规则转换
+    */
+    template<class T, class Enable = void>
+    struct Arg {
+        using type = typename std::conditional<std::is_pointer<T>::value, const void *, T>::type;
+    };
+    template<class T>
+    struct Arg<T, typename std::enable_if<std::is_integral<T>::value && (sizeof(T) < sizeof(int))>::type> {
+        using type = int;
+    };
+    template<class T>
+    struct Arg<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+        using type = typename std::conditional<(sizeof(T) <= sizeof(int)), int, long long>::type;
+    };
+    template<class T>
+    struct Arg<T, typename std::enable_if<std::is_floating_point<T>::value && (sizeof(T) <= sizeof(double))>::type> {
+        using type = double;
+    };
+    template<class T>
+    struct Arg<T *, typename std::enable_if<std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+        using type = const char *;
+    };
+    template<size_t N>
+    struct Arg<char[N]> {
+        using type = const char *;
+    };
+    template<size_t N>
+    struct Arg<const char[N]> {
+        using type = const char *;
+    };
+    template<class T>
+    using ArgType = typename Arg<typename std::remove_cv<typename std::remove_reference<T>::type>::type>::type;
+
+    template<class ...ARGS>
+    static void write(Logger &logger, int level, const char *file, const char *func, int line, const char *fmt, ARGS &&...args);
+
+    static void encode(LogContext &) {}
+    template<class T, class ...ARGS>
+    static void encode(LogContext &log, T &&arg, ARGS &&...args) {
+        encodeArg(log, (ArgType<T>)arg);
+        encode(log, std::forward<ARGS>(args)...);
+    }
+
+    template<class T>
+    static void encodeArg(LogContext &log, T value) {
+        static_assert(std::is_trivially_copyable<T>::value, "DeferL only supports integral, floating point, enum, C string and pointer arguments");
+        log.append((const char *)&value, sizeof(value));
+    }
+    static void encodeArg(LogContext &log, const char *value) {
+        //字符串以长度+内容+'\0'编码，解码时直接指向该位置
+        uint32_t size = value ? (uint32_t)strlen(value) : 0;
+        log.append((const char *)&size, sizeof(size));
+        log.append(value ? value : "", size);
+        log.append("", 1);
+    }
+
+    template<class T>
+    static T decodeArg(const char *&raw, T *) {
+        T value;
+        memcpy(&value, raw, sizeof(value));
+        raw += sizeof(value);
+        return value;
+    }
+    static const char *decodeArg(const char *&raw, const char **) {
+        uint32_t size;
+        memcpy(&size, raw, sizeof(size));
+        auto value = raw + sizeof(size);
+        raw = value + size + 1;
+        return value;
+    }
+
+    template<size_t ...I>
+    struct Indexes {};
+    template<size_t N, size_t ...I>
+    struct MakeIndexes : MakeIndexes<N - 1, N - 1, I...> {};
+    template<size_t ...I>
+    struct MakeIndexes<0, I...> {
+        using type = Indexes<I...>;
+    };
+
+    template<class ...T, size_t ...I>
+    static void format(LogContext &log, const char *fmt, std::tuple<T...> &args, Indexes<I...>) {
+        formatV(log, fmt, std::get<I>(args)...);
+    }
+    static void formatV(LogContext &log, const char *fmt, ...);
+
+    template<class ...T>
+    static void decode(LogContext &log, const char *fmt, const char *raw, size_t) {
+        //花括号初始化保证参数按从左到右的顺序解码
+        std::tuple<T...> args{decodeArg(raw, (T *)nullptr)...};
+        format(log, fmt, args, typename MakeIndexes<sizeof...(T)>::type());
+    }
+};//struct LogDeferred
+
+/**
+ * 日志调用点的限流与采样（见WriteRateL/WriteSampleL）
+ *      每个宏展开处有一个静态LogLimiter，限制该调用点的输出频率：
+ *      kRate：令牌桶，每秒最多n条（允许n条的突发）
+ *      kSample：每n条输出1条
+ *  使用粗粒度单调时钟（kClockCoarse）计时，被丢弃的日志只计数，不创建LogContext；该调用点下一条被输出的日志前，
+ *  每秒最多输出一条"suppressed N messages"汇总
+*/
+class LogLimiter {
+public:
+    enum Mode {
+        kRate,
+        kSample,
+    };//enum Mode
+
+    LogLimiter(Mode mode, uint32_t n);
+
+    /**
+     * 是否输出本条日志；需要输出汇总时先写入汇总日志
+    */
+    bool allow(Logger &logger, int level, const char *file, const char *func, int line) {
+        if (mode_ == kSample) {
+            if (counter_.fetch_add(1, std::memory_order_relaxed) % n_) {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } else if (!takeToken() && !refillAndTake()) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (suppressed_.load(std::memory_order_relaxed)) {
+            report(logger, level, file, func, line);
+        }
+        return true;
+    }
+
+    /**
+     * 累计被丢弃的日志数量
+    */
+    uint64_t suppressedTotal() const {
+        return suppressed_total_.load(std::memory_order_relaxed) + suppressed_.load(std::memory_order_relaxed);
+    }
+private:
+    /**
+     * kRate：有令牌时只有原子操作，不读取时钟
+    */
+    bool takeToken() {
+        return tokens_.load(std::memory_order_relaxed) > 0 && tokens_.fetch_sub(1, std::memory_order_relaxed) > 0;
+    }
+    /**
+     * kRate：令牌用完时才读取时钟，按上次补充后经过的时间补充令牌（不超过n个）后再取
+     *      任意长度为T秒的区间内最多放行n + n * T条，与按时补充的令牌桶相同
+    */
+    bool refillAndTake();
+    void refill(uint64_t now);
+    void report(Logger &logger, int level, const char *file, const char *func, int line);
+private:
+    const Mode mode_;
+    const uint32_t n_;
+    std::atomic<uint64_t> counter_{0};//kSample：调用次数
+    std::atomic<int64_t> tokens_;//kRate：剩余令牌
+    std::atomic<uint64_t> next_refill_ms_{0};
+    std::atomic<uint64_t> last_refill_ms_{0};//仅在抢到补充令牌的线程中修改，其他线程之后读取
+    std::atomic<uint64_t> suppressed_{0};//上次汇总后丢弃的数量
+    std::atomic<uint64_t> suppressed_total_{0};
+    std::atomic<uint64_t> next_report_ms_{0};
+};//class LogLimiter
+
+/**
+ * 将日志宏中的流式表达式转换为void，使日志宏可以作为条件表达式的一个分支
+ *      &的优先级低于<<，因此先完成所有<<输入
+*/
+struct LogContextCaptureVoidify {
+    void operator&(const LogContextCapture &) const {}
+};
+
+template<class ...ARGS>
+void LogDeferred::write(Logger &logger, int level, const char *file, const char *func, int line, const char *fmt, ARGS &&...args) {
+    if (!logger.enabled(level)) return;
+
+    auto log = LogContext::create(level, file, func, line);
+    encode(*log, std::forward<ARGS>(args)...);
+    log->setDeferred(fmt, &decode<ArgType<ARGS>...>);
+    logger.writeLog(log);
+}
+
+#if defined(__GNUC__)
+/**
+ * 仅用于编译期检查DeferL的格式字符串与参数（不会被调用）
+*/
+inline void logDeferredFormatCheck(const char *, ...) __attribute__((format(printf, 1, 2)));
+inline void logDeferredFormatCheck(const char *, ...) {}
+#define AVC_LOG_FORMAT_CHECK(fmt, ...) (false ? avc::util::logDeferredFormatCheck(fmt, ##__VA_ARGS__) : (void)0)
+#else
+#define AVC_LOG_FORMAT_CHECK(fmt, ...) ((void)0)
+#endif
+
 }// namespace util
 } // namespace avc
 
+/**
+ * 编译期最低日志级别（LogLevel数值）
+ *      低于该级别的日志宏条件为常量，整条日志语句（包括<<后的参数求值）被编译器消除
+ *      例如：-DAVC_LOG_MIN_LEVEL=2 只保留Warn及以上级别的日志
+*/
+#ifndef AVC_LOG_MIN_LEVEL
+#define AVC_LOG_MIN_LEVEL 0
+#endif
+
+/**
+ * 日志级别是否开启：先判断编译期最低级别，再判断Logger的运行时最低级别
+ *      未开启时不创建LogContextCapture，<<后的参数也不会求值
+*/
+#define AVC_LOG_ENABLED(logger, level) ((int)(level) >= AVC_LOG_MIN_LEVEL && (logger).enabled(level))
+
 /**
  * C++流式格式日志输入形式
 */
-#define WriteL(level) avc::util::LogContextCapture(avc::util::Logger::instance(), (level), __FILE__, __FUNCTION__, __LINE__)
+#define WriteL(level) \
+    !AVC_LOG_ENABLED(avc::util::Logger::instance(), (level)) ? (void)0 : \
+    avc::util::LogContextCaptureVoidify() & avc::util::LogContextCapture(avc::util::Logger::instance(), (level), __FILE__, __FUNCTION__, __LINE__)
 #define TraceL WriteL(avc::util::LogLevel::kLogLevelTrace)
 #define DebugL WriteL(avc::util::LogLevel::kLogLevelDebug)
 #define InfoL  WriteL(avc::util::LogLevel::kLogLevelInfo)
 #define WarnL  WriteL(avc::util::LogLevel::kLogLevelWarn)
+/**
+ * 限流/采样的C++流式日志：
+ *      WarnRateL(10) << "sendto failed: " << err;   //该调用点每秒最多输出10条
+ *      DebugSampleL(100) << "recv packet " << seq;   //该调用点每100条输出1条
+ *  n必须是常量（在调用点的静态LogLimiter首次构造时使用）
+*/
+#define AVC_LOG_LIMITER(mode, n) \
+    ([]() -> avc::util::LogLimiter & { static avc::util::LogLimiter s_limiter((mode), (n)); return s_limiter; }())
+#define WriteLimitL(level, mode, n) \
+    !AVC_LOG_ENABLED(avc::util::Logger::instance(), (level)) || \
+    !AVC_LOG_LIMITER(mode, n).allow(avc::util::Logger::instance(), (level), __FILE__, __FUNCTION__, __LINE__) ? (void)0 : \
+    avc::util::LogContextCaptureVoidify() & avc::util::LogContextCapture(avc::util::Logger::instance(), (level), __FILE__, __FUNCTION__, __LINE__)
+#define WriteRateL(level, perSecond) WriteLimitL(level, avc::util::LogLimiter::kRate, perSecond)
+#define WriteSampleL(level, n) WriteLimitL(level, avc::util::LogLimiter::kSample, n)
+#define TraceRateL(perSecond) WriteRateL(avc::util::LogLevel::kLogLevelTrace, perSecond)
+#define DebugRateL(perSecond) WriteRateL(avc::util::LogLevel::kLogLevelDebug, perSecond)
+#define WarnRateL(perSecond) WriteRateL(avc::util::LogLevel::kLogLevelWarn, perSecond)
+#define TraceSampleL(n) WriteSampleL(avc::util::LogLevel::kLogLevelTrace, n)
+#define DebugSampleL(n) WriteSampleL(avc::util::LogLevel::kLogLevelDebug, n)
+#define WarnSampleL(n) WriteSampleL(avc::util::LogLevel::kLogLevelWarn, n)
+
 /**
  * C格式化日志输入形式
 */
-#define PrintL(level, ...) avc::util::LogContextCaptureWrapper::PrintLog(avc::util::Logger::instance(), (level), __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__);
+#define PrintL(level, ...) \
+    (!AVC_LOG_ENABLED(avc::util::Logger::instance(), (level)) ? (void)0 : \
+    avc::util::LogContextCaptureWrapper::PrintLog(avc::util::Logger::instance(), (level), __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__));
 #define PrintT(...) PrintL(avc::util::LogLevel::kLogLevelTrace, __VA_ARGS__)
 #define PrintD(...) PrintL(avc::util::LogLevel::kLogLevelDebug, __VA_ARGS__)
 
+/**
+ * 延迟格式化日志输入形式：与PrintL用法相同，格式化在AsyncLogWriter线程完成
+ *      DeferD("session %d recv %u bytes from %s", id, bytes, ip.data());
+ *  fmt必须是字符串字面量（日志写出前一直被引用）
+*/
+#define DeferL(level, fmt, ...) \
+    (AVC_LOG_FORMAT_CHECK(fmt, ##__VA_ARGS__), !AVC_LOG_ENABLED(avc::util::Logger::instance(), (level)) ? (void)0 : \
+    avc::util::LogDeferred::write(avc::util::Logger::instance(), (level), __FILE__, __FUNCTION__, __LINE__, "" fmt, ##__VA_ARGS__))
+#define DeferT(fmt, ...) DeferL(avc::util::LogLevel::kLogLevelTrace, fmt, ##__VA_ARGS__)
+#define DeferD(fmt, ...) DeferL(avc::util::LogLevel::kLogLevelDebug, fmt, ##__VA_ARGS__)
+#define DeferW(fmt, ...) DeferL(avc::util::LogLevel::kLogLevelWarn, fmt, ##__VA_ARGS__)
+
 #endif
\ No newline at end of file
@@ -57,6 +57,10 @@ public:
         return size_;
     }
 
+    size_t capacity() const {
+        return capacity_;
+    }
+
     inline void assign(const char* buffer, size_t size) {
         /**
          * 确定buffer的大小，如果没有指定的话
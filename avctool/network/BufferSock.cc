@@ -51,8 +51,8 @@ public:
              * 需要考虑发送失败和部分发送成功情况
             */
             if (n <= 0) {
-                //发送失败
-                WarnL << "sendto failed: " << get_uv_errmsg();
+                //发送失败（对端不可达时每次发送都会失败，限制该日志的频率）
+                WarnRateL(10) << "sendto failed: " << get_uv_errmsg();
                 
                 if (UV_EAGAIN == get_uv_error()) {
                     //发送错误类型是重试，则继续发送
@@ -4,6 +4,7 @@
 
 #include "network/SockUtil.h"
 #include "error/uv_errno.h"
+#include "util/OnceToken.h"
 
 namespace avc {
 namespace util {
@@ -21,6 +22,16 @@ void Socket::setOnRead(OnRead &&cb) {
     on_read_ = std::move(cb);
 }
 
+void Socket::setOnErr(OnErr &&cb) {
+    LOCK_GUARD(mtx_event_);
+    on_err_ = std::move(cb);
+}
+
+void Socket::setOnFlush(OnFlush &&cb) {
+    LOCK_GUARD(mtx_event_);
+    on_flush_ = std::move(cb);
+}
+
 int Socket::bindUdpSocket(uint16_t port, const std::string &ip, bool reuseAddr) {
     //创建udp socket文件描述符
     int fd = SockUtil::bindUdpSocket(port, ip.c_str(), reuseAddr);
@@ -59,6 +70,61 @@ int Socket::send(Buffer::Ptr buffer, struct sockaddr *addr, socklen_t len, bool
     return send_l(BufferSock::create(std::move(buffer), addr, len), true, tryFlush);
 }
 
+void Socket::moveTo(const EventPoller::Ptr &poller, OnMoved &&cb) {
+    auto current = getPoller();
+    if (poller == nullptr || poller == current) {
+        if (cb) cb(poller ? 0 : -1);
+        return;
+    }
+
+    //注销与切换poller_需要在原EventPoller线程中完成，避免与I/O事件回调并发
+    auto self = shared_from_this();
+    auto onMoved = std::make_shared<OnMoved>(std::move(cb));
+    current->async([self, current, poller, onMoved]()->void {
+        if (self->getPoller() != current) {
+            //投递期间已被迁移到其他EventPoller，重新投递
+            self->moveTo(poller, std::move(*onMoved));
+            return;
+        }
+        self->moveTo_l(poller, std::move(*onMoved));
+    });
+}
+
+void Socket::moveTo_l(const EventPoller::Ptr &poller, OnMoved &&cb) {
+    int fd = -1;
+    int type = SockNum::kTypeInvalid;
+    {
+        //send线程通过mtx_fd_访问sock_fd_与poller_
+        LOCK_GUARD(mtx_fd_);
+        if (sock_fd_) {
+            fd = sock_fd_->rawFd();
+            type = sock_fd_->type();
+            sock_fd_->setPoller(poller);
+        }
+        poller_ = poller;
+        //重新注册时包含写事件，写事件触发前禁止用户flushData
+        sendable_ = false;
+    }
+
+    auto self = shared_from_this();
+    auto onMoved = std::make_shared<OnMoved>(std::move(cb));
+    poller->async([self, fd, type, onMoved]()->void {
+        int ret = 0;
+        if (fd != -1) {
+            ret = self->attachEvent(fd, type);
+            if (ret == -1) {
+                WarnL << "Failed to attach fd event after moving socket";
+            }
+        }
+        if (*onMoved) (*onMoved)(ret);
+    });
+}
+
+EventPoller::Ptr Socket::getPoller() {
+    LOCK_GUARD(mtx_fd_);
+    return poller_;
+}
+
 int Socket::send_l(Buffer::Ptr buffer, bool isBufferSock, bool tryFlush) {
     //判断buffer大小
     auto size = buffer ? buffer->size() : 0;
@@ -66,9 +132,26 @@ int Socket::send_l(Buffer::Ptr buffer, bool isBufferSock, bool tryFlush) {
         return 0;
     }
 
+    SocketPacer::Ptr pacer;
+    bool schedule = false;
     {
         LOCK_GUARD(mtx_send_buffer_waiting_);
-        send_buffer_waiting_.emplace_back(std::make_pair(buffer, isBufferSock));
+        pacer = pacer_;
+        if (pacer) {
+            //限速：先进入限速队列，由EventPoller线程按令牌释放到一级缓存
+            schedule = pacer->push(std::move(buffer), isBufferSock);
+        }
+        else {
+            send_buffer_waiting_.emplace_back(std::make_pair(buffer, isBufferSock));
+        }
+    }
+
+    if (pacer) {
+        //释放时flush，不需要tryFlush
+        if (schedule) {
+            schedulePacing(pacer);
+        }
+        return size;
     }
 
     /**
@@ -139,6 +222,86 @@ int Socket::flushAll() {
 }
 
 
+void Socket::setPacing(uint64_t rateBytesPerSec, uint64_t burstBytes, const PacerGroup::Ptr &group) {
+    SocketPacer::Ptr pacer;
+    if (rateBytesPerSec) {
+        pacer = SocketPacer::create(rateBytesPerSec, burstBytes, group);
+    }
+
+    bool flush = false;
+    {
+        LOCK_GUARD(mtx_send_buffer_waiting_);
+        if (pacer_) {
+            /**
+             * 原限速队列中的数据按顺序进入一级缓存，之后send的数据进入新的限速队列
+             *      原限速的定时器释放时队列已空，自动停止
+            */
+            std::list<SocketPacer::Packet> queued;
+            pacer_->drain(queued);
+            flush = !queued.empty();
+            send_buffer_waiting_.splice(send_buffer_waiting_.end(), queued);
+        }
+        pacer_ = pacer;
+    }
+
+    if (flush) {
+        auto self = shared_from_this();
+        getPoller()->post([self]()->void {
+            self->flushAll();
+        });
+    }
+}
+
+uint64_t Socket::getShapedBytes() {
+    LOCK_GUARD(mtx_send_buffer_waiting_);
+    return pacer_ ? pacer_->shapedBytes() : 0;
+}
+
+uint64_t Socket::getQueuedBytes() {
+    LOCK_GUARD(mtx_send_buffer_waiting_);
+    return pacer_ ? pacer_->queuedBytes() : 0;
+}
+
+void Socket::schedulePacing(const SocketPacer::Ptr &pacer) {
+    std::weak_ptr<Socket> weakSelf = shared_from_this();
+    auto poller = getPoller();
+    //在EventPoller线程中调用send时同步释放，不增加延迟
+    poller->post([weakSelf, pacer, poller]()->void {
+        auto self = weakSelf.lock();
+        if (!self) return;
+
+        auto delayMs = self->releasePaced(pacer, poller->now());
+        if (!delayMs) return;
+        /**
+         * 令牌不足：定时器在令牌补足时再次释放，直到队列清空
+         *      Socket迁移后仍在原EventPoller中释放，flushAll通过mtx_fd_访问fd
+        */
+        poller->addDelayTask((int)delayMs, [weakSelf, pacer, poller]()->uint64_t {
+            auto self = weakSelf.lock();
+            return self ? self->releasePaced(pacer, poller->now()) : 0;
+        });
+    });
+}
+
+uint64_t Socket::releasePaced(const SocketPacer::Ptr &pacer, uint64_t now) {
+    uint64_t waitUsec = 0;
+    bool released = false;
+    {
+        //持有一级缓存锁，保证与send_l、setPacing之间的顺序
+        LOCK_GUARD(mtx_send_buffer_waiting_);
+        std::list<SocketPacer::Packet> packets;
+        waitUsec = pacer->release(now, packets);
+        released = !packets.empty();
+        send_buffer_waiting_.splice(send_buffer_waiting_.end(), packets);
+    }
+
+    if (released) {
+        flushAll();
+    }
+    //毫秒定时器，向上取整保证补足后再释放
+    return (waitUsec + 999) / 1000;
+}
+
 int Socket::flushData(int fd, int type, bool isEventPollerThread) {
     //首先处理发送二级缓存中的BufferList
     decltype(send_buffer_sending_) send_buffer_sending_tmp;
@@ -153,26 +316,32 @@ int Socket::flushData(int fd, int type, bool isEventPollerThread) {
          * 一级缓存中也没有数据，则等待send函数调用
          * 此时可以移除socket的写事件，避免写事件回调(因为下一次send函数调用，会触发flush)
         */
-        LOCK_GUARD(mtx_send_buffer_waiting_);
-        if (send_buffer_waiting_.empty()) {
-
-            if (isEventPollerThread) {
-                /**
-                 * isEventPollerThread条件下，才调用stopWriteableEvent的原因
-                 *      （1）如果用户调用的flushData函数，没有必要移除写事件,
-                 *           因此如果存在写事件的话，下次触发写事件的时候，就会移除写事件
-                */
-                stopWritableEvent(fd);
-                /**
-                 * 
-                */
+        bool flushed = false;
+        {
+            LOCK_GUARD(mtx_send_buffer_waiting_);
+            if (send_buffer_waiting_.empty()) {
+                if (isEventPollerThread) {
+                    /**
+                     * isEventPollerThread条件下，才调用stopWriteableEvent的原因
+                     *      （1）如果用户调用的flushData函数，没有必要移除写事件,
+                     *           因此如果存在写事件的话，下次触发写事件的时候，就会移除写事件
+                    */
+                    stopWritableEvent(fd);
+                    flushed = true;
+                }
+            }
+            else {
+                //一级缓存中存在数据，则创建BufferList发送数据
+                send_buffer_sending_tmp.emplace_back(BufferList::create(std::move(send_buffer_waiting_), nullptr, type == SockNum::kTypeUdp));
+            }
+        }
+        if (send_buffer_sending_tmp.empty()) {
+            if (flushed) {
+                //释放一级缓存锁后回调，回调中可以继续send
                 onFlushed();
             }
             return 0;
         }
-
-        //一级缓存中存在数据，则创建BufferList发送数据
-        send_buffer_sending_tmp.emplace_back(BufferList::create(std::move(send_buffer_waiting_), nullptr, type == SockNum::kTypeUdp));
     }
 
     //发送数据
@@ -212,8 +381,10 @@ int Socket::flushData(int fd, int type, bool isEventPollerThread) {
             }
         }
         //其他错误类型，说明socket出现异常
-        //emitError();
-        return -1;;
+        if (isEventPollerThread) {
+            emitError(SocketException(get_uv_error(), get_uv_errmsg()));
+        }
+        return -1;
     }
 
     if (!send_buffer_sending_tmp.empty()) {
@@ -315,13 +486,18 @@ Socket::Socket(EventPoller::Ptr poller) {
 int Socket::attachEvent(int fd, int type) {
     int ret = -1;
     std::weak_ptr<Socket> self = shared_from_this();
+    /**
+     * Socket迁移后，原EventPoller本轮已收集的就绪事件仍可能回调，
+     * 通过比较注册时的EventPoller忽略这些事件
+    */
+    EventPoller *poller = poller_.get();
     if (type == SockNum::kTypeTcpServer) {
         //Tcp Acceptor监听读事件与异常事件即可
         ret = poller_->attachEvent(fd,
                 EventPoller::Event::kEventRead | EventPoller::Event::kEventError,
-                [this, fd, type, self](int events)->void {
+                [this, fd, type, self, poller](int events)->void {
                     auto socket = self.lock();
-                    if (socket == nullptr) return;
+                    if (socket == nullptr || socket->poller_.get() != poller) return;
 
                     if (events & EventPoller::kEventRead) {
                         socket->onAcceptable();
@@ -339,10 +515,12 @@ int Socket::attachEvent(int fd, int type) {
         */
         ret = poller_->attachEvent(fd,
                 EventPoller::Event::kEventRead | EventPoller::Event::kEventWrite | EventPoller::Event::kEventError,
-                [this, fd, type, self](int events)->void {
+                [this, fd, type, self, poller](int events)->void {
                     auto socket = self.lock();
                     //socket被销毁（用户持有的socket被销毁）
                     if (socket == nullptr) { return; }
+                    //socket已经迁移到其他EventPoller
+                    if (socket->poller_.get() != poller) { return; }
 
                     if (events & EventPoller::Event::kEventRead) {
                         socket->onReadable(fd, type);
@@ -351,6 +529,12 @@ int Socket::attachEvent(int fd, int type) {
                         socket->onWritable(fd, type);
                     }
                     if (events & EventPoller::Event::kEventError) {
+                        //读取并清除socket上的错误，避免水平触发下重复回调
+                        int err = 0;
+                        socklen_t len = sizeof(err);
+                        getsockopt(fd, SOL_SOCKET, SO_ERROR, (char *)&err, &len);
+                        err = uv_translate_posix_error(err);
+                        socket->emitError(SocketException(err, uv_strerror(err)));
                     }
                 }
         );
@@ -392,6 +576,13 @@ void Socket::onReadable(int fd, int type) {
     int nread = 0;
     auto buffer = poller_->getSharedBuffer();
 
+    //统计读事件处理耗时，与结束时间使用同一时钟（EventPoller设置时钟源时now()为虚拟时间）
+    auto begin = EventPollerStats::now();
+    OnceToken token(nullptr, [&]()->void {
+        auto end = EventPollerStats::now();
+        busy_usec_ += end > begin ? end - begin : 0;
+    });
+
     struct sockaddr_storage addr; socklen_t len;
     while(enable_recv_) {
         /**
@@ -399,13 +590,16 @@ void Socket::onReadable(int fd, int type) {
          * 需要重新调用接口接收数据
         */
         do {
-            nread = ::recvfrom(fd, buffer->data(), buffer->size() - 1, 0, (struct sockaddr *)&addr, &len);
+            //len为输入输出参数，每次接收前需要重置为地址缓存大小
+            len = sizeof(addr);
+            //使用容量而不是size接收，size会被上一次接收的数据长度修改
+            nread = ::recvfrom(fd, buffer->data(), buffer->capacity() - 1, 0, (struct sockaddr *)&addr, &len);
         } while (-1 == nread && UV_EINTR == get_uv_error());
 
         if (nread == 0) {
             if (type == SockNum::kTypeTcp) {
                 //tcp连接读到eof，需要处理出错
-                //emitError()
+                emitError(SocketException(UV_EOF, "end of file"));
             }
             else {
                 //udp socket时，打印错误即可，不需要抛出异常
@@ -425,7 +619,7 @@ void Socket::onReadable(int fd, int type) {
             //其他类型出错
             if (SockNum::kTypeTcp == type) {
                 //tcp触发异常
-                //emitError();
+                emitError(SocketException(err, uv_strerror(err)));
             }
             else {
                 WarnL << "Recv err on udp socket: " << get_uv_errmsg();
@@ -450,15 +644,35 @@ void Socket::onReadable(int fd, int type) {
 }
 
 void Socket::onWritable(int fd, int type) {
-
+    //socket可写，发送缓存数据；缓存为空时移除可写事件并启用sendable_
+    flushData(fd, type, true);
 }
 
 void Socket::emitError(const SocketException& exception) noexcept {
-
+    LOCK_GUARD(mtx_event_);
+    if (!on_err_) {
+        WarnL << "Socket error: " << exception.what();
+        return;
+    }
+    try {
+        on_err_(exception);
+    }
+    catch (std::exception &e) {
+        WarnL << "Exception occurred when emit on_err " << e.what();
+    }
 }
 
 void Socket::onFlushed() {
-
+    LOCK_GUARD(mtx_event_);
+    if (!on_flush_) {
+        return;
+    }
+    try {
+        on_flush_();
+    }
+    catch (std::exception &e) {
+        WarnL << "Exception occurred when emit on_flush " << e.what();
+    }
 }
 
 }
@@ -3,12 +3,15 @@
 
 #include <memory>
 #include <list>
+#include <atomic>
+#include <functional>
 
 #include "util/Util.h"
 
 #include "network/Buffer.h"
 #include "network/BufferSock.h"
 #include "network/SockUtil.h"
+#include "network/SocketPacer.h"
 #include "poller/EventPollerPool.h"
 #include "util/MutexWrapper.h"
 
@@ -69,6 +72,15 @@ public:
         if (sock_num_) return sock_num_->type();
         return SockNum::kTypeInvalid;
     }
+
+    /**
+     * 从当前EventPoller注销I/O事件，之后由poller管理（用于Socket迁移）
+     *      需要在当前EventPoller线程中调用，保证注销同步完成
+    */
+    void setPoller(const EventPoller::Ptr &poller) {
+        detachEvent();
+        poller_ = poller;
+    }
 private:
     SockFD(int fd, SockNum::Type type, EventPoller::Ptr poller) 
         : sock_num_(SockNum::create(fd, type)), poller_(poller) {}
@@ -87,7 +99,20 @@ private:
 
 class SocketException : public std::exception {
 public:
-    SocketException(int err, std::string &&);
+    /**
+     * @param err uv错误码
+    */
+    SocketException(int err, std::string &&msg) : err_(err), msg_(std::move(msg)) {}
+
+    int getErrCode() const {
+        return err_;
+    }
+    const char *what() const noexcept override {
+        return msg_.c_str();
+    }
+private:
+    int err_;
+    std::string msg_;
 };//class SocketException
 
 /**
@@ -106,11 +131,25 @@ public:
     };
     using Ptr = std::shared_ptr<Socket>;
     using OnRead = std::function<void(Buffer::Ptr, struct sockaddr *addr, socklen_t len)>;
+    /**
+     * 迁移完成回调，在新的EventPoller线程中执行，参数为0表示成功
+    */
+    using OnMoved = std::function<void(int)>;
+    /**
+     * 出错回调（异常事件、tcp连接断开等），在EventPoller线程中执行
+    */
+    using OnErr = std::function<void(const SocketException &)>;
+    /**
+     * 发送缓存清空回调：缓存数据因内核写缓冲满而等待可写事件，之后全部写入内核时在EventPoller线程中执行
+    */
+    using OnFlush = std::function<void()>;
 
     AVC_STATIC_CREATOR(Socket)
     ~Socket();
 
     void setOnRead(OnRead &&cb);
+    void setOnErr(OnErr &&cb);
+    void setOnFlush(OnFlush &&cb);
     /**
      * 创建UDP Socket
     */
@@ -123,6 +162,54 @@ public:
     int send(std::string &&bufer, struct sockaddr *addr = nullptr, socklen_t len = 0, bool tryFlush = true);
     int send(const char *buffer, size_t size = 0, struct sockaddr *addr = nullptr, socklen_t len = 0, bool tryFlush = true);
     int send(Buffer::Ptr buffer, struct sockaddr *addr = nullptr, socklen_t len = 0, bool tryFlush = true);
+
+    /**
+     * 设置发送限速（令牌桶）：send的数据先进入限速队列，按令牌释放到发送缓存后flush，
+     * 避免一次将整个GOP写入内核
+     *      释放在EventPoller线程中执行，令牌不足时通过毫秒定时器等待补足，同一毫秒到期的Socket在一次唤醒中释放
+     *      有令牌时即可发出一个Buffer（允许透支），因此burstBytes不小于一个Buffer也能保持平均速率
+     *  可在任意线程调用，重新设置时令牌桶重置；rateBytesPerSec为0时取消限速，队列中的数据立即进入发送缓存
+     * @param rateBytesPerSec 本Socket的速率，字节/秒
+     * @param burstBytes 空闲后允许的突发字节数，同时决定释放的粒度，建议不小于几毫秒的数据量；最小为1字节，0按1处理
+     * @param group 共享上行带宽的一组Socket的总限速，可以为nullptr；组内Socket可以属于不同的EventPoller
+    */
+    void setPacing(uint64_t rateBytesPerSec, uint64_t burstBytes, const PacerGroup::Ptr &group = nullptr);
+    /**
+     * 通过限速释放的累计字节数，以及当前在限速队列中等待的字节数；未设置限速时为0
+    */
+    uint64_t getShapedBytes();
+    uint64_t getQueuedBytes();
+
+    /**
+     * 发送缓存中有数据在等待可写事件（内核写缓冲已满），清空后触发OnFlush回调
+     *      限速队列中的数据不计入
+    */
+    bool isSocketBusy() const {
+        return !sendable_.load();
+    }
+
+    /**
+     * 将Socket迁移到另一个EventPoller，用于运行时负载均衡
+     *      (1) 在原EventPoller线程中同步注销fd的I/O事件，此后原线程不再回调该Socket
+     *      (2) 切换poller_，发送缓存保持不变
+     *      (3) 在新EventPoller线程中重新注册读写事件，写事件触发后继续发送缓存数据
+     *  迁移期间到达的数据保留在内核接收缓冲中（水平触发），注册后继续接收，不会丢失
+     *  setOnRead注册的回调此后在新EventPoller线程中执行
+    */
+    void moveTo(const EventPoller::Ptr &poller, OnMoved &&cb = nullptr);
+
+    /**
+     * 获取Socket当前所属的EventPoller
+    */
+    EventPoller::Ptr getPoller();
+
+    /**
+     * 处理读事件（包含on_read回调）的累计耗时，单位微秒
+     *      负载均衡时，用于评估会话的负载
+    */
+    uint64_t getBusyMicroseconds() const {
+        return busy_usec_.load(std::memory_order_relaxed);
+    }
 private:
     /**
      * 将socket文件描述符，封装成Socket类处理
@@ -152,6 +239,16 @@ private:
     */                      
     int flushAll();
 
+    /**
+     * 在EventPoller线程中释放限速队列，直到队列清空或令牌不足时启动定时器
+    */
+    void schedulePacing(const SocketPacer::Ptr &pacer);
+    /**
+     * 按令牌将限速队列中的Buffer移动到一级缓存并flush
+     * @return 返回下一次释放前需要等待的时间，单位毫秒，0表示队列已空
+    */
+    uint64_t releasePaced(const SocketPacer::Ptr &pacer, uint64_t now);
+
     int flushData(int fd, int type, bool isEventPollerThread);
 
     /**
@@ -183,6 +280,10 @@ private:
     int attachEvent(int fd, int type);
     void setSocketFD(SockFD::Ptr sockFd);
     void closeSocket();
+    /**
+     * 在原EventPoller线程中执行迁移
+    */
+    void moveTo_l(const EventPoller::Ptr &poller, OnMoved &&cb);
 
     void onAcceptable();
     /**
@@ -207,6 +308,8 @@ private:
     EventPoller::Ptr poller_;
 
     OnRead on_read_;
+    OnErr on_err_;
+    OnFlush on_flush_;
     MutexWrapper<std::recursive_mutex> mtx_event_;
     /**
      * 使用recursive_mutex而不是mutex
@@ -248,6 +351,10 @@ private:
      * bool参数描述这个节点是BufferSock；否则为Buffer
     */
     std::list<std::pair<Buffer::Ptr, bool>> send_buffer_waiting_;
+    /**
+     * 发送限速，nullptr表示不限速，由mtx_send_buffer_waiting_保护
+    */
+    SocketPacer::Ptr pacer_;
     /**
      *  此缓存为二级缓冲， 发送时将一级缓存数据移动到二级缓存
      *  为什么需要二级缓存？
@@ -262,6 +369,11 @@ private:
     MutexWrapper<std::recursive_mutex> mtx_send_buffer_sending_;
     std::list<BufferList::Ptr> send_buffer_sending_;
     //std::list<>
+
+    /**
+     * 处理读事件的累计耗时
+    */
+    std::atomic<uint64_t> busy_usec_{0};
 };//class Socket
 
 
@@ -0,0 +1,257 @@
+#ifndef NETWORK_SOCKETCOROUTINE_H
+#define NETWORK_SOCKETCOROUTINE_H
+
+#include "poller/Coroutine.h"
+
+#if AVC_HAS_COROUTINE
+
+#include <deque>
+
+#include "network/Socket.h"
+
+namespace avc {
+namespace util {
+
+/**
+ * Socket的协程封装
+ *      auto reader = CoSocket::create(sock);
+ *      while (true) {
+ *          auto packet = co_await reader->recv();
+ *          if (!packet.buffer) break;
+ *          co_await reader->sendAll(packet.buffer, packet.addr(), packet.len);
+ *      }
+ *
+ *  CoSocket接管Socket::setOnRead/setOnErr/setOnFlush回调：
+ *      (1) 有协程等待时，直接使用EventPoller的共享接收Buffer恢复协程（不拷贝），
+ *          该Buffer在协程下一次挂起前有效，需要跨越co_await保存时请自行拷贝
+ *      (2) 没有协程等待时，拷贝数据并缓存，下一次recv()立即返回；
+ *          缓存超过setMaxCached时丢弃新数据包（与内核接收缓冲满时相同），见droppedCount
+ *      (3) Socket出错或调用close()后，等待中的协程被恢复，recv()返回buffer为nullptr的空数据包，
+ *          协程据此退出并释放其持有的CoSocket::Ptr
+ *  recv()/sendAll()/close()需要在Socket所属的EventPoller线程中调用
+*/
+class CoSocket : public std::enable_shared_from_this<CoSocket> {
+public:
+    using Ptr = std::shared_ptr<CoSocket>;
+
+    /**
+     * 接收到的数据包
+    */
+    struct Packet {
+        Buffer::Ptr buffer;
+        struct sockaddr_storage storage;
+        socklen_t len = 0;
+
+        struct sockaddr *addr() { return (struct sockaddr *)&storage; }
+    };//struct Packet
+
+    /**
+     * 默认最多缓存的数据包数量
+    */
+    static constexpr size_t kDefaultMaxCached = 1024;
+
+    static Ptr create(const Socket::Ptr &sock) {
+        Ptr ret(new CoSocket(sock));
+        std::weak_ptr<CoSocket> weakSelf = ret;
+        sock->setOnRead([weakSelf](Buffer::Ptr buffer, struct sockaddr *addr, socklen_t len)->void {
+            auto self = weakSelf.lock();
+            if (self) {
+                self->onRead(std::move(buffer), addr, len);
+            }
+        });
+        sock->setOnErr([weakSelf](const SocketException &ex)->void {
+            auto self = weakSelf.lock();
+            if (self) {
+                WarnL << "Socket error, close coroutine socket: " << ex.what();
+                self->close();
+            }
+        });
+        sock->setOnFlush([weakSelf]()->void {
+            auto self = weakSelf.lock();
+            if (self) {
+                self->onFlush();
+            }
+        });
+        return ret;
+    }
+
+    ~CoSocket() {
+        /**
+         * 协程帧持有CoSocket::Ptr时，等待期间CoSocket不会析构（需要close()或出错才能退出）
+         *      这里只剩下未持有Ptr的协程，它们无法再被恢复，销毁其协程帧
+        */
+        for (auto handle : { recv_waiting_, send_waiting_ }) {
+            if (handle) {
+                handle.destroy();
+            }
+        }
+    }
+
+    const Socket::Ptr &getSocket() const {
+        return sock_;
+    }
+
+    /**
+     * 关闭：不再接收数据，恢复等待中的协程，之后recv()返回空数据包，sendAll()返回-1
+     *      Socket对象由调用者与CoSocket共同持有，CoSocket析构后释放
+    */
+    void close() {
+        if (closed_) {
+            return;
+        }
+        //不重置Socket的回调（可能正在回调中调用close），回调检查closed_后忽略
+        closed_ = true;
+
+        //恢复的协程可能释放最后一个Ptr
+        auto self = shared_from_this();
+        auto recvHandle = recv_waiting_;
+        auto sendHandle = send_waiting_;
+        recv_waiting_ = nullptr;
+        send_waiting_ = nullptr;
+        if (recvHandle) recvHandle.resume();
+        if (sendHandle) sendHandle.resume();
+    }
+
+    bool closed() const {
+        return closed_;
+    }
+
+    class RecvAwaiter {
+    public:
+        explicit RecvAwaiter(CoSocket &sock) : sock_(sock) {}
+
+        bool await_ready() const noexcept {
+            return !sock_.cached_.empty() || sock_.closed_;
+        }
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            sock_.recv_waiting_ = handle;
+        }
+        Packet await_resume() {
+            if (sock_.cached_.empty()) {
+                //关闭后返回空数据包
+                return sock_.closed_ ? Packet() : std::move(sock_.delivered_);
+            }
+            Packet packet = std::move(sock_.cached_.front());
+            sock_.cached_.pop_front();
+            return packet;
+        }
+    private:
+        CoSocket &sock_;
+    };//class RecvAwaiter
+
+    /**
+     * co_await recv()：等待下一个数据包，buffer为nullptr表示已关闭
+    */
+    RecvAwaiter recv() {
+        return RecvAwaiter(*this);
+    }
+
+    /**
+     * co_await sendAll()：数据写入Socket发送缓存，内核写缓冲已满时挂起，
+     * 直到发送缓存全部写入内核（Socket::setOnFlush）或关闭后恢复
+     *      不挂起时与Socket::send相同，没有额外开销；限速队列中的数据不等待
+     * @return 同Socket::send；关闭后返回-1
+    */
+    class SendAwaiter {
+    public:
+        SendAwaiter(CoSocket &sock, int ret) : sock_(sock), ret_(ret) {}
+
+        bool await_ready() const noexcept {
+            return sock_.closed_ || !sock_.sock_->isSocketBusy();
+        }
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            sock_.send_waiting_ = handle;
+        }
+        int await_resume() const noexcept {
+            return sock_.closed_ ? -1 : ret_;
+        }
+    private:
+        CoSocket &sock_;
+        int ret_;
+    };//class SendAwaiter
+
+    SendAwaiter sendAll(Buffer::Ptr buffer, struct sockaddr *addr = nullptr, socklen_t len = 0) {
+        if (closed_) {
+            return SendAwaiter(*this, -1);
+        }
+        return SendAwaiter(*this, sock_->send(std::move(buffer), addr, len));
+    }
+
+    /**
+     * 未被协程取走的数据包数量
+    */
+    size_t cachedCount() const {
+        return cached_.size();
+    }
+
+    /**
+     * 缓存已满而丢弃的数据包数量
+    */
+    uint64_t droppedCount() const {
+        return dropped_;
+    }
+
+    /**
+     * 设置最多缓存的数据包数量，默认kDefaultMaxCached
+    */
+    void setMaxCached(size_t maxCached) {
+        max_cached_ = maxCached;
+    }
+private:
+    explicit CoSocket(Socket::Ptr sock) : sock_(std::move(sock)) {}
+
+    void onFlush() {
+        if (send_waiting_) {
+            auto handle = send_waiting_;
+            send_waiting_ = nullptr;
+            handle.resume();
+        }
+    }
+
+    void onRead(Buffer::Ptr buffer, struct sockaddr *addr, socklen_t len) {
+        if (closed_) {
+            return;
+        }
+        if (!recv_waiting_ && cached_.size() >= max_cached_) {
+            //协程处理不及时，丢弃新数据包，避免缓存无限增长
+            ++dropped_;
+            return;
+        }
+
+        Packet packet;
+        packet.len = len;
+        if (addr && len > 0 && len <= sizeof(packet.storage)) {
+            memcpy(&packet.storage, addr, len);
+        }
+
+        if (recv_waiting_) {
+            //协程等待中，不拷贝数据直接恢复
+            packet.buffer = std::move(buffer);
+            delivered_ = std::move(packet);
+            auto handle = recv_waiting_;
+            recv_waiting_ = nullptr;
+            handle.resume();
+            return;
+        }
+
+        //共享接收Buffer会被下一次接收覆盖，缓存时需要拷贝
+        packet.buffer = BufferRaw::create(buffer->data(), buffer->size());
+        cached_.emplace_back(std::move(packet));
+    }
+private:
+    Socket::Ptr sock_;
+    bool closed_ = false;
+    std::coroutine_handle<> recv_waiting_;
+    std::coroutine_handle<> send_waiting_;
+    Packet delivered_;
+    std::deque<Packet> cached_;
+    size_t max_cached_ = kDefaultMaxCached;
+    uint64_t dropped_ = 0;
+};//class CoSocket
+
+}//namespace util
+}//namespace avc
+
+#endif//AVC_HAS_COROUTINE
+
+#endif
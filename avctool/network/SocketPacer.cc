@@ -0,0 +1,86 @@
+#include "SocketPacer.h"
+
+#include <algorithm>
+
+namespace avc {
+namespace util {
+
+bool SocketPacer::push(Buffer::Ptr buffer, bool isBufferSock) {
+    auto size = buffer->size();
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.emplace_back(std::move(buffer), isBufferSock);
+    queued_bytes_.store(queued_bytes_.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+    if (group_) {
+        group_->queued_bytes_.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    if (scheduled_) {
+        return false;
+    }
+    scheduled_ = true;
+    return true;
+}
+
+uint64_t SocketPacer::release(uint64_t now, std::list<Packet> &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bucket_.refill(now);
+
+    uint64_t bytes = 0;
+    {
+        std::unique_lock<std::mutex> groupLock;
+        if (group_) {
+            groupLock = std::unique_lock<std::mutex>(group_->mutex_);
+            group_->bucket_.refill(now);
+        }
+        while (!queue_.empty() && bucket_.available()) {
+            auto size = queue_.front().first->size();
+            if (group_) {
+                if (!group_ready_) {
+                    /**
+                     * 预约组令牌：按组令牌桶当前的透支量排队，到期后释放时不再扣除
+                     *      组内大量Socket同时等待时，每个Socket只在轮到自己时唤醒一次，
+                     *      而不是在组令牌补足时一起竞争
+                    */
+                    group_ready_ = now + group_->bucket_.waitUsec();
+                    group_->bucket_.consume(size);
+                }
+                if (group_ready_ > now) {
+                    break;
+                }
+                group_ready_ = 0;
+            }
+            bucket_.consume(size);
+            bytes += size;
+            out.splice(out.end(), queue_, queue_.begin());
+        }
+    }
+
+    if (bytes) {
+        shaped_bytes_.store(shaped_bytes_.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        queued_bytes_.store(queued_bytes_.load(std::memory_order_relaxed) - bytes, std::memory_order_relaxed);
+        if (group_) {
+            group_->shaped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            group_->queued_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+    }
+
+    if (queue_.empty()) {
+        scheduled_ = false;
+        return 0;
+    }
+    auto wait = std::max(bucket_.waitUsec(), group_ready_ > now ? group_ready_ - now : 0);
+    return wait ? wait : 1;
+}
+
+void SocketPacer::drain(std::list<Packet> &out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (group_) {
+        group_->queued_bytes_.fetch_sub(queued_bytes_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    queued_bytes_.store(0, std::memory_order_relaxed);
+    group_ready_ = 0;
+    out.splice(out.end(), queue_);
+}
+
+}//namespace util
+}//namespace avc
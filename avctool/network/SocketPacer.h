@@ -0,0 +1,178 @@
+#ifndef NETWORK_SOCKETPACER_H
+#define NETWORK_SOCKETPACER_H
+
+#include <list>
+#include <algorithm>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+
+#include "util/Util.h"
+#include "network/Buffer.h"
+
+namespace avc {
+namespace util {
+
+/**
+ * 令牌桶，单位字节，时间单位微秒
+ *      令牌以字节*1000000为单位保存，按整数累加，没有舍入误差
+ *      允许透支：有令牌时即可发出一个任意大小的Buffer，令牌变为负数，之后等待补足，长期平均速率不变
+ *  不加锁，由使用者保证串行访问
+*/
+class TokenBucket {
+public:
+    /**
+     * @param rateBytesPerSec 速率，字节/秒，0表示不限速
+     * @param burstBytes 桶容量（空闲后允许的突发字节数），最小为1字节：
+     *                   容量为0时令牌永远不会大于0，队列无法释放，定时器会一直重复唤醒
+    */
+    TokenBucket(uint64_t rateBytesPerSec, uint64_t burstBytes)
+        : rate_(rateBytesPerSec), capacity_((int64_t)std::max<uint64_t>(burstBytes, 1) * 1000000) {}
+
+    /**
+     * 按now补充令牌，第一次调用时桶为满；时间回退时不补充
+    */
+    void refill(uint64_t now) {
+        if (!rate_) {
+            return;
+        }
+        if (!last_) {
+            tokens_ = capacity_;
+        }
+        else if (now > last_ && tokens_ < capacity_) {
+            //先比较时间，避免长时间空闲后乘法溢出
+            auto elapsed = now - last_;
+            auto fullUsec = (uint64_t)(capacity_ - tokens_) / rate_ + 1;
+            tokens_ = elapsed >= fullUsec ? capacity_ : std::min(capacity_, tokens_ + (int64_t)(elapsed * rate_));
+        }
+        if (now > last_) {
+            last_ = now;
+        }
+    }
+
+    bool available() const {
+        return !rate_ || tokens_ > 0;
+    }
+
+    void consume(size_t bytes) {
+        if (rate_) {
+            tokens_ -= (int64_t)bytes * 1000000;
+        }
+    }
+
+    /**
+     * 距离再次有令牌的时间，单位微秒，0表示当前有令牌
+    */
+    uint64_t waitUsec() const {
+        return available() ? 0 : (uint64_t)(-tokens_) / rate_ + 1;
+    }
+private:
+    uint64_t rate_;
+    int64_t capacity_;
+    int64_t tokens_ = 0;
+    uint64_t last_ = 0;
+};//class TokenBucket
+
+/**
+ * 共享上行带宽的一组Socket的总限速
+ *      组内Socket可以属于不同的EventPoller，令牌桶加锁访问
+*/
+class PacerGroup {
+public:
+    using Ptr = std::shared_ptr<PacerGroup>;
+
+    AVC_STATIC_CREATOR(PacerGroup)
+
+    /**
+     * 通过限速释放的累计字节数
+    */
+    uint64_t shapedBytes() const {
+        return shaped_bytes_.load(std::memory_order_relaxed);
+    }
+    /**
+     * 组内所有Socket在限速队列中等待的字节数
+    */
+    uint64_t queuedBytes() const {
+        return queued_bytes_.load(std::memory_order_relaxed);
+    }
+private:
+    friend class SocketPacer;
+
+    /**
+     * @param burstBytes 总突发字节数，小于1时按1字节处理（见TokenBucket）
+    */
+    PacerGroup(uint64_t rateBytesPerSec, uint64_t burstBytes) : bucket_(rateBytesPerSec, burstBytes) {}
+private:
+    std::mutex mutex_;
+    TokenBucket bucket_;
+    std::atomic<uint64_t> shaped_bytes_{0};
+    std::atomic<uint64_t> queued_bytes_{0};
+};//class PacerGroup
+
+/**
+ * Socket发送限速：位于Socket::send_l与一级缓存（flushData发送的数据）之间
+ *      send_l将Buffer放入限速队列，轮询线程按Socket与PacerGroup两个令牌桶释放到一级缓存并flush，
+ *      令牌不足时通过EventPoller毫秒定时器在补足时再次释放（见Socket::setPacing）
+ *      组令牌不足时按透支量预约，组内Socket依次释放
+ *  队列与令牌桶由mutex_保护，加锁顺序：Socket一级缓存锁 -> mutex_ -> PacerGroup::mutex_
+*/
+class SocketPacer {
+public:
+    using Ptr = std::shared_ptr<SocketPacer>;
+    using Packet = std::pair<Buffer::Ptr, bool>;
+
+    AVC_STATIC_CREATOR(SocketPacer)
+
+    /**
+     * 加入限速队列
+     * @return 是否需要调度释放（没有正在等待执行的释放任务或定时器）
+    */
+    bool push(Buffer::Ptr buffer, bool isBufferSock);
+
+    /**
+     * 按令牌释放队列头部的Buffer到out
+     * @param now 当前时间，单位微秒
+     * @return 返回下一次释放前需要等待的时间，单位微秒；0表示队列已空，之后push时重新调度
+    */
+    uint64_t release(uint64_t now, std::list<Packet> &out);
+
+    /**
+     * 取消限速时，取出队列中全部Buffer
+    */
+    void drain(std::list<Packet> &out);
+
+    uint64_t shapedBytes() const {
+        return shaped_bytes_.load(std::memory_order_relaxed);
+    }
+    uint64_t queuedBytes() const {
+        return queued_bytes_.load(std::memory_order_relaxed);
+    }
+private:
+    /**
+     * @param burstBytes 小于1时按1字节处理（见TokenBucket）
+     * @param group 总限速，可以为nullptr
+    */
+    SocketPacer(uint64_t rateBytesPerSec, uint64_t burstBytes, const PacerGroup::Ptr &group)
+        : bucket_(rateBytesPerSec, burstBytes), group_(group) {}
+private:
+    std::mutex mutex_;
+    TokenBucket bucket_;
+    PacerGroup::Ptr group_;
+    std::list<Packet> queue_;
+    /**
+     * 已投递释放任务或已启动定时器，队列清空时复位
+    */
+    bool scheduled_ = false;
+    /**
+     * 队头Buffer已预约组令牌，到该时间释放，0表示未预约
+    */
+    uint64_t group_ready_ = 0;
+    std::atomic<uint64_t> shaped_bytes_{0};
+    std::atomic<uint64_t> queued_bytes_{0};
+};//class SocketPacer
+
+}//namespace util
+}//namespace avc
+
+#endif
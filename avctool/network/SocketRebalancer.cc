@@ -0,0 +1,148 @@
+#include "SocketRebalancer.h"
+
+#include <algorithm>
+
+#include "util/Util.h"
+
+namespace avc {
+namespace util {
+
+SocketRebalancer::SocketRebalancer(std::vector<EventPoller::Ptr> pollers, int threshold)
+    : pollers_(std::move(pollers)), threshold_(threshold), last_time_(getMonotonicMicrosecond()) {
+}
+
+void SocketRebalancer::addSocket(const Socket::Ptr &sock) {
+    if (!sock) return;
+
+    Session session;
+    session.sock = sock;
+    session.last_busy = sock->getBusyMicroseconds();
+
+    LOCK_GUARD(mutex_);
+    sessions_.push_back(session);
+}
+
+void SocketRebalancer::removeSocket(const Socket::Ptr &sock) {
+    LOCK_GUARD(mutex_);
+    for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+        if (it->sock.lock() == sock) {
+            sessions_.erase(it);
+            return;
+        }
+    }
+}
+
+int SocketRebalancer::rebalance() {
+    if (pollers_.size() < 2) return 0;
+
+    std::vector<int> loads;
+    loads.reserve(pollers_.size());
+    for (auto &poller : pollers_) {
+        loads.push_back(poller->load());
+    }
+
+    LOCK_GUARD(mutex_);
+    auto now = getMonotonicMicrosecond();
+    auto elapsed = now - last_time_;
+    last_time_ = now;
+
+    /**
+     * 统计每个会话在本周期内的负载，同时移除已销毁的会话
+     *      sockets与sessions_一一对应，保存会话当前所属的EventPoller下标
+    */
+    std::vector<std::pair<Socket::Ptr, size_t>> sockets;
+    sockets.reserve(sessions_.size());
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        auto sock = it->sock.lock();
+        if (!sock) {
+            it = sessions_.erase(it);
+            continue;
+        }
+
+        auto busy = sock->getBusyMicroseconds();
+        it->load = elapsed ? (int)((busy - it->last_busy) * 100 / elapsed) : 0;
+        it->last_busy = busy;
+
+        auto poller = sock->getPoller();
+        size_t index = 0;
+        while (index < pollers_.size() && pollers_[index] != poller) ++index;
+        sockets.emplace_back(std::move(sock), index);
+        ++it;
+    }
+
+    /**
+     * ThreadLoadCounter基于毫秒级时间戳采样，短任务较多时会低估负载，
+     * 因此EventPoller的负载取ThreadLoadCounter负载与其上会话负载之和的较大值
+    */
+    std::vector<int> sessionLoads(pollers_.size(), 0);
+    for (size_t index = 0; index < sockets.size(); ++index) {
+        if (sockets[index].second < pollers_.size()) {
+            sessionLoads[sockets[index].second] += sessions_[index].load;
+        }
+    }
+    for (size_t index = 0; index < loads.size(); ++index) {
+        loads[index] = std::max(loads[index], sessionLoads[index]);
+    }
+
+    int moved = 0;
+    while (moved < kMaxMovesPerPass) {
+        size_t maxIndex = 0, minIndex = 0;
+        for (size_t index = 1; index < loads.size(); ++index) {
+            if (loads[index] > loads[maxIndex]) maxIndex = index;
+            if (loads[index] < loads[minIndex]) minIndex = index;
+        }
+
+        int diff = loads[maxIndex] - loads[minIndex];
+        if (diff < threshold_) break;
+
+        /**
+         * 选择迁移后能够缩小差值的最重会话：会话负载需要小于差值，
+         * 否则迁移后目标EventPoller成为新的最重负载，导致来回迁移
+        */
+        int candidate = -1;
+        for (size_t index = 0; index < sockets.size(); ++index) {
+            if (sockets[index].second != maxIndex) continue;
+
+            int load = sessions_[index].load;
+            if (load > 0 && load < diff && (candidate == -1 || load > sessions_[candidate].load)) {
+                candidate = (int)index;
+            }
+        }
+        if (candidate == -1) break;
+
+        auto &sock = sockets[candidate].first;
+        DebugL << "Move socket from poller#" << maxIndex << "(" << loads[maxIndex] << "%) to poller#"
+               << minIndex << "(" << loads[minIndex] << "%), session load: " << sessions_[candidate].load << "%";
+        sock->moveTo(pollers_[minIndex]);
+
+        //负载统计需要一段时间才能反映迁移结果，使用会话负载预估迁移后的负载
+        loads[maxIndex] -= sessions_[candidate].load;
+        loads[minIndex] += sessions_[candidate].load;
+        sockets[candidate].second = minIndex;
+        ++moved;
+    }
+    return moved;
+}
+
+void SocketRebalancer::start(const EventPoller::Ptr &poller, int intervalMs) {
+    stop();
+
+    std::weak_ptr<SocketRebalancer> weakSelf = shared_from_this();
+    timer_ = poller->addDelayTask(intervalMs, [weakSelf, intervalMs]()->uint64_t {
+        auto self = weakSelf.lock();
+        if (!self) return 0;
+
+        self->rebalance();
+        return intervalMs;
+    });
+}
+
+void SocketRebalancer::stop() {
+    if (timer_) {
+        timer_->cancel();
+        timer_ = nullptr;
+    }
+}
+
+}
+}
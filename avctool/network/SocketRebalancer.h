@@ -0,0 +1,78 @@
+#ifndef NETWORK_SOCKETREBALANCER_H
+#define NETWORK_SOCKETREBALANCER_H
+
+#include <vector>
+#include <memory>
+
+#include "network/Socket.h"
+#include "util/MutexWrapper.h"
+#include "util/Nocopyable.h"
+
+namespace avc {
+namespace util {
+
+/**
+ * Socket负载再均衡
+ *      Socket创建时通过EventPollerPool选择EventPoller，此后不会改变，
+ *      长时间运行的重负载会话可能集中在某个EventPoller上。SocketRebalancer周期性执行：
+ *          (1) 通过ThreadLoadCounter获取各个EventPoller的负载
+ *          (2) 通过Socket::getBusyMicroseconds统计每个会话在本周期内的负载，
+ *              EventPoller负载取(1)与其上会话负载之和的较大值
+ *          (3) 负载差值超过阈值时，将最重负载EventPoller上的会话迁移到最空闲的EventPoller，
+ *              优先迁移迁移后能缩小差值的最重会话
+ *  ThreadLoadCounter统计的是一段时间窗口内的负载，迁移后需要一段时间才能反映，
+ *  因此每个周期最多迁移kMaxMovesPerPass个会话，周期不宜小于负载统计窗口
+*/
+class SocketRebalancer : public std::enable_shared_from_this<SocketRebalancer>,
+                         Nocopyable {
+public:
+    using Ptr = std::shared_ptr<SocketRebalancer>;
+
+    static constexpr int kMaxMovesPerPass = 4;
+
+    AVC_STATIC_CREATOR(SocketRebalancer)
+
+    /**
+     * 添加需要再均衡的会话，仅保存weak_ptr，Socket销毁后自动移除
+    */
+    void addSocket(const Socket::Ptr &sock);
+    void removeSocket(const Socket::Ptr &sock);
+
+    /**
+     * 执行一次再均衡
+     * @return 返回迁移的会话数量
+    */
+    int rebalance();
+
+    /**
+     * 在poller上周期执行rebalance
+    */
+    void start(const EventPoller::Ptr &poller, int intervalMs = 2000);
+    void stop();
+private:
+    /**
+     * @param pollers 参与均衡的EventPoller
+     * @param threshold 最大与最小负载差值(0~100)超过阈值时才迁移
+    */
+    explicit SocketRebalancer(std::vector<EventPoller::Ptr> pollers, int threshold = 20);
+
+    struct Session {
+        std::weak_ptr<Socket> sock;
+        uint64_t last_busy = 0;
+        int load = 0;//上个周期内的负载(0~100)
+    };//struct Session
+private:
+    std::vector<EventPoller::Ptr> pollers_;
+    int threshold_;
+
+    uint64_t last_time_;
+    std::vector<Session> sessions_;
+    MutexWrapper<std::mutex> mutex_;
+
+    EventPoller::DelayTask::Ptr timer_;
+};//class SocketRebalancer
+
+}
+}
+
+#endif
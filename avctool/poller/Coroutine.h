@@ -0,0 +1,191 @@
+#ifndef POLLER_COROUTINE_H
+#define POLLER_COROUTINE_H
+
+/**
+ * C++20协程支持（可选）
+ *      仅在编译器支持协程（-std=c++20）时可用，通过AVC_HAS_COROUTINE判断
+ *      协程层完全构建在现有回调接口之上（post/addDelayTask/setOnRead），不影响回调方式的代码
+*/
+#if defined(__cpp_impl_coroutine) && __cplusplus >= 202002L
+#define AVC_HAS_COROUTINE 1
+#else
+#define AVC_HAS_COROUTINE 0
+#endif
+
+#if AVC_HAS_COROUTINE
+
+#include <coroutine>
+#include <vector>
+#include <exception>
+
+#include "poller/EventPoller.h"
+#include "log/Log.h"
+
+namespace avc {
+namespace util {
+
+/**
+ * 协程帧内存池
+ *      每个EventPoller对应一个轮询线程，协程通常在所属轮询线程中创建与销毁，
+ *      因此按线程缓存空闲帧即等价于按EventPoller缓存，分配与释放都不需要加锁
+ *      帧大小按kGranularity对齐分桶，超过kMaxFrameSize的帧直接使用堆内存
+*/
+class CoroutineFramePool {
+public:
+    static constexpr size_t kGranularity = 64;
+    static constexpr size_t kMaxFrameSize = 2048;
+    static constexpr size_t kMaxCached = 1024;
+
+    static void *allocate(size_t size) {
+        auto bucket = bucketOf(size);
+        if (bucket < kBucketCount) {
+            auto &frees = freeList(bucket);
+            if (!frees.empty()) {
+                auto ptr = frees.back();
+                frees.pop_back();
+                return ptr;
+            }
+            return ::operator new((bucket + 1) * kGranularity);
+        }
+        return ::operator new(size);
+    }
+
+    static void deallocate(void *ptr, size_t size) {
+        auto bucket = bucketOf(size);
+        if (bucket < kBucketCount) {
+            auto &frees = freeList(bucket);
+            if (frees.size() < kMaxCached) {
+                frees.push_back(ptr);
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+private:
+    static constexpr size_t kBucketCount = kMaxFrameSize / kGranularity;
+
+    static size_t bucketOf(size_t size) {
+        return (size + kGranularity - 1) / kGranularity - 1;
+    }
+
+    /**
+     * 线程退出时释放缓存的帧
+    */
+    struct FreeLists {
+        std::vector<void *> lists[kBucketCount];
+        ~FreeLists() {
+            for (auto &list : lists) {
+                for (auto ptr : list) ::operator delete(ptr);
+            }
+        }
+    };
+
+    static std::vector<void *> &freeList(size_t bucket) {
+        static thread_local FreeLists s_lists;
+        return s_lists.lists[bucket];
+    }
+};//class CoroutineFramePool
+
+/**
+ * 协程任务：创建后立即执行，执行结束自动销毁（fire-and-forget）
+ *      CoTask handleSession(...) {
+ *          co_await resumeOn(poller);
+ *          auto packet = co_await reader->recv();
+ *          co_await sleepFor(100);
+ *      }
+ *  协程内部未捕获的异常被记录到日志后丢弃
+*/
+class CoTask {
+public:
+    struct promise_type {
+        CoTask get_return_object() noexcept { return CoTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {
+            try {
+                throw;
+            }
+            catch (std::exception &ex) {
+                WarnL << "Unhandled exception in coroutine: " << ex.what();
+            }
+            catch (...) {
+                WarnL << "Unhandled exception in coroutine";
+            }
+        }
+
+        static void *operator new(size_t size) {
+            return CoroutineFramePool::allocate(size);
+        }
+        static void operator delete(void *ptr, size_t size) {
+            CoroutineFramePool::deallocate(ptr, size);
+        }
+    };//struct promise_type
+};//class CoTask
+
+/**
+ * co_await resumeOn(poller)：切换到poller的轮询线程继续执行
+ *      已处于该轮询线程时不挂起
+*/
+class ResumeOnAwaiter {
+public:
+    explicit ResumeOnAwaiter(EventPoller::Ptr poller) : poller_(std::move(poller)) {}
+
+    bool await_ready() const noexcept {
+        return poller_->isCurrentThread();
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        poller_->post([handle]() { handle.resume(); }, false);
+    }
+    void await_resume() const noexcept {}
+private:
+    EventPoller::Ptr poller_;
+};//class ResumeOnAwaiter
+
+inline ResumeOnAwaiter resumeOn(EventPoller::Ptr poller) {
+    return ResumeOnAwaiter(std::move(poller));
+}
+
+/**
+ * co_await sleepFor(ms)：基于addDelayTask挂起指定毫秒数，在poller的轮询线程中恢复
+*/
+class SleepAwaiter {
+public:
+    SleepAwaiter(EventPoller::Ptr poller, int delayMs) : poller_(std::move(poller)), delay_ms_(delayMs) {}
+
+    bool await_ready() const noexcept {
+        return delay_ms_ <= 0 && poller_->isCurrentThread();
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+        poller_->addDelayTask(delay_ms_ > 0 ? delay_ms_ : 0, [handle]()->uint64_t {
+            handle.resume();
+            return 0;
+        });
+    }
+    void await_resume() const noexcept {}
+private:
+    EventPoller::Ptr poller_;
+    int delay_ms_;
+};//class SleepAwaiter
+
+inline SleepAwaiter sleepFor(const EventPoller::Ptr &poller, int delayMs) {
+    return SleepAwaiter(poller, delayMs);
+}
+
+/**
+ * 在当前轮询线程中挂起，非轮询线程调用时抛出异常
+*/
+inline SleepAwaiter sleepFor(int delayMs) {
+    auto poller = EventPoller::getCurrentPoller();
+    if (!poller) {
+        throw std::runtime_error("sleepFor must be called on an EventPoller thread");
+    }
+    return SleepAwaiter(std::move(poller), delayMs);
+}
+
+}//namespace util
+}//namespace avc
+
+#endif//AVC_HAS_COROUTINE
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef POLLER_DELAYSCHEDULE_H
+#define POLLER_DELAYSCHEDULE_H
+
+#include <stdint.h>
+
+namespace avc {
+namespace util {
+
+/**
+ * 周期延迟任务的重新调度方式
+ *      kFixedDelay：下一次到期时间 = 本次执行时间 + 周期，执行较晚时之后的周期整体后移（误差会累积）
+ *      kFixedRate： 下一次到期时间 = 本次到期时间 + 周期，没有累积误差；
+ *                   执行较晚错过了之后的周期时，立即补执行，连续执行最多max_burst次（包含按时的一次），
+ *                   超过后跳过剩余错过的周期，从当前时间之后的第一个周期继续
+ *  时间单位由调用者决定（毫秒定时器为毫秒，高精度定时器为微秒）
+ *  每个延迟任务一个实例，仅由轮询线程访问
+*/
+class DelaySchedule {
+public:
+    enum Mode {
+        kFixedDelay,
+        kFixedRate,
+    };//enum Mode
+
+    explicit DelaySchedule(Mode mode = kFixedDelay, uint32_t maxBurst = 1)
+        : mode_(mode), max_burst_(maxBurst ? maxBurst : 1) {}
+
+    /**
+     * 本次执行结束后，计算下一次到期时间
+     * @param deadline 本次的到期时间
+     * @param now 本次执行时的当前时间
+     * @param period 回调返回的周期
+     * @param skipped 累加跳过的周期数量
+     * @return 下一次到期时间，不大于now时表示需要立即补执行
+    */
+    uint64_t next(uint64_t deadline, uint64_t now, uint64_t period, uint64_t &skipped) {
+        if (mode_ == kFixedDelay) {
+            return now + period;
+        }
+
+        auto next = deadline + period;
+        if (next > now) {
+            burst_ = 0;
+            return next;
+        }
+        //错过了下一个周期：补执行
+        if (++burst_ < max_burst_) {
+            return next;
+        }
+        //超过最大连续执行次数，跳到now之后的第一个周期
+        auto missed = (now - next) / period + 1;
+        skipped += missed;
+        burst_ = 0;
+        return next + missed * period;
+    }
+
+    Mode mode() const {
+        return mode_;
+    }
+private:
+    Mode mode_;
+    uint32_t max_burst_;
+    uint32_t burst_ = 0;//本次已连续补执行的次数
+};//class DelaySchedule
+
+}//namespace util
+}//namespace avc
+
+#endif
@@ -1,6 +1,7 @@
 #include "EventPoller.h"
 
 #include <assert.h>
+#include <algorithm>
 
 #include "log/Log.h"
 
@@ -9,6 +10,10 @@
 #if HAS_EPOLL
 #include "poller/EpollWrapper.h"
 #endif
+#if HAS_TIMERFD
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
 
 #include "error/uv_errno.h"
 
@@ -17,6 +22,22 @@ namespace util {
 
 #define SOCKET_DEFAULT_BUF_SIZE (256 * 1024)
 
+/**
+ * 轮询线程所属的EventPoller
+*/
+static thread_local std::weak_ptr<EventPoller> s_current_poller;
+/**
+ * 轮询线程正在运行的EventPoller，用于不加锁地判断调用线程是否处于该EventPoller的runLoop中
+*/
+static thread_local EventPoller *s_running_poller = nullptr;
+
+/**
+ * 到期时间向上对齐到slackMs的整数倍（以程序启动时间为起点）
+*/
+static inline uint64_t alignDeadline(uint64_t deadline, uint32_t slackMs) {
+    return slackMs > 1 ? (deadline + slackMs - 1) / slackMs * slackMs : deadline;
+}
+
 EventPoller::~EventPoller() {
     shutdown();
 }
@@ -26,6 +47,16 @@ void EventPoller::runLoop(bool blocked) {
 #if 0
         TraceL << "runLoop started blocked: " << blocked;
 #endif
+        s_current_poller = shared_from_this();
+        s_running_poller = this;
+        /**
+         * shared_from_this之后再通知runLoop(false)返回，
+         * 否则调用者可能在轮询线程启动前释放EventPoller，导致bad_weak_ptr
+        */
+        sem_started_.post();
+        setNow(EventPollerStats::now());
+        //本次轮询的唤醒时间，用于统计从唤醒到再次休眠的耗时
+        uint64_t wakeupTime = 0;
         while (!exit_) {
             /**
              * next下次轮询函数唤醒时间，单位毫秒
@@ -39,13 +70,22 @@ void EventPoller::runLoop(bool blocked) {
             struct epoll_event signaled_events[EPOLL_SIZE];
             /**
              * 进入休眠前，记录下时间
+             *      休眠与唤醒各读取一次时钟，线程负载、轮询统计与now()共用
             */
-            onSleep();
-            int n = epoll_wait(epoll_fd_, signaled_events, EPOLL_SIZE, next > 0 ? next : -1);
+            auto sleepTime = EventPollerStats::now();
+            onSleep(sleepTime);
+            onLoopEnd(wakeupTime, sleepTime);
+            //使用时钟源时，定时器由时钟源推进时调度，不按到期时间唤醒
+            int n = epoll_wait(epoll_fd_, signaled_events, EPOLL_SIZE, next > 0 && !clock_ ? next : -1);
             /**
              * 从休眠中唤醒，也需要记录下时间
             */
-            onWakeup();
+            wakeupTime = EventPollerStats::now();
+            onWakeup(wakeupTime);
+            setNow(wakeupTime);
+            stats_.loops.add();
+            stats_.wait_usec.record(wakeupTime - sleepTime);
+            stats_.events_per_loop.record(n > 0 ? n : 0);
             if (n > 0) {
                 for (int index = 0; index < n; ++index) {
                     EventRecord::Ptr signaledEventRecord;
@@ -96,7 +136,16 @@ void EventPoller::runLoop(bool blocked) {
             struct timeval tv;
             tv.tv_sec = next / 1000L;
             tv.tv_usec = (next % 1000L) * 1000;
-            int ret = Select(maxFd + 1, &readSet, &writeSet, &exceptSet, next > 0 ? &tv : nullptr);
+            auto sleepTime = EventPollerStats::now();
+            onSleep(sleepTime);
+            onLoopEnd(wakeupTime, sleepTime);
+            int ret = Select(maxFd + 1, &readSet, &writeSet, &exceptSet, next > 0 && !clock_ ? &tv : nullptr);
+            wakeupTime = EventPollerStats::now();
+            onWakeup(wakeupTime);
+            setNow(wakeupTime);
+            stats_.loops.add();
+            stats_.wait_usec.record(wakeupTime - sleepTime);
+            stats_.events_per_loop.record(ret > 0 ? ret : 0);
             if (ret <= 0) {
                 //超时唤醒，或者出错-1
                 /**
@@ -126,6 +175,8 @@ void EventPoller::runLoop(bool blocked) {
                 }
             }
 #endif
+            //上一个回调的结束时间即下一个回调的开始时间，每个回调只读取一次时钟
+            auto callbackTime = statsNow();
             for (auto& signaled : signaledEventRecords) {
                 try {
                     signaled->cb_(signaled->signaled_events_);
@@ -133,8 +184,19 @@ void EventPoller::runLoop(bool blocked) {
                 catch (...) {
                     WarnL << "Handle signaled event callback error.";
                 }
+                auto now = EventPollerStats::now();
+                auto usec = now - callbackTime;
+                stats_.callback_usec.record(usec);
+                auto budget = slow_callback_usec_.load(std::memory_order_relaxed);
+                if (budget && usec > budget) {
+                    reportSlow(StrPrinter << "fd event callback, fd: " << signaled->fd_, usec, budget, now);
+                }
+                callbackTime = now;
+                setNow(now);
             }
+            stats_.events.add(signaledEventRecords.size());
         }
+        s_running_poller = nullptr;
     }
     else {
         exit_ = false;
@@ -142,7 +204,6 @@ void EventPoller::runLoop(bool blocked) {
 #if 0
             setThreadName((StrPrinter << "EventPoller#" << this).c_str());
 #endif
-            sem_started_.post();
             runLoop(true);
         });
         sem_started_.wait();
@@ -153,12 +214,18 @@ void EventPoller::runLoop(bool blocked) {
  * 退出循环
 */
 void EventPoller::shutdown() {
-    async([this]()->void {
-        if (!exit_) {
-            throw Exit();
-        }
-        TraceL << "EventPoller has alyready exited.";
-    });
+    try {
+        async([this]()->void {
+            if (!exit_) {
+                throw Exit();
+            }
+            TraceL << "EventPoller has alyready exited.";
+        });
+    }
+    catch (Exit&) {
+        //未调用runLoop时在调用线程中同步执行，不能从析构函数中抛出
+        exit_ = true;
+    }
 
     if (thread_ && thread_->joinable()) {
         thread_->join();
@@ -169,6 +236,14 @@ void EventPoller::shutdown() {
     detachEvent(pipe_.readFD());
     pipe_.closeFD();
 
+#if HAS_TIMERFD
+    if (timer_fd_ != -1) {
+        detachEvent(timer_fd_);
+        close(timer_fd_);
+        timer_fd_ = -1;
+    }
+#endif
+
 #if HAS_EPOLL
     TraceL << "close epoll fd";
     epoll_close(epoll_fd_);
@@ -206,6 +281,7 @@ int EventPoller::detachEvent(int fd) {
         }
 #endif
         event_records_.erase(fd);
+        event_count_.store(event_records_.size(), std::memory_order_relaxed);
         return ret;
     }
 
@@ -255,7 +331,7 @@ int EventPoller::modifyEvent(int fd, int events) {
  *          1）对于Window平台，轮询函数需要网络套接字才能唤醒，因此管道需要使用套接字模拟实现
  *          2）对于Linux平台，轮询函数使用文件描述符唤醒，因此使用管道即可
 */
-EventPoller::Task::Ptr EventPoller::async(EventPoller::TaskIn&& task, bool may_sync) {
+EventPoller::Task::Ptr EventPoller::async(EventPoller::TaskIn&& task, bool may_sync, TaskOrigin origin) {
     if (may_sync && currentThread()) {
         task();
         return nullptr;
@@ -264,7 +340,8 @@ EventPoller::Task::Ptr EventPoller::async(EventPoller::TaskIn&& task, bool may_s
     auto job = Task::create(std::move(task));
     {
         LOCK_GUARD(tasks_mutex_);
-        tasks_.push_back(job);
+        tasks_.emplace_back([job]()->void { (*job)(); }, origin);
+        pending_tasks_.fetch_add(1, std::memory_order_relaxed);
     }
 
     //通过写管道唤醒轮询函数
@@ -272,7 +349,7 @@ EventPoller::Task::Ptr EventPoller::async(EventPoller::TaskIn&& task, bool may_s
     return job;
 }
 
-EventPoller::Task::Ptr EventPoller::async_first(EventPoller::TaskIn&& task, bool may_sync) {
+EventPoller::Task::Ptr EventPoller::async_first(EventPoller::TaskIn&& task, bool may_sync, TaskOrigin origin) {
     if (may_sync && currentThread()) {
         task();
         return nullptr;
@@ -281,7 +358,8 @@ EventPoller::Task::Ptr EventPoller::async_first(EventPoller::TaskIn&& task, bool
     auto job = Task::create(std::move(task));
     {
         LOCK_GUARD(tasks_mutex_);
-        tasks_.push_front(job);
+        tasks_first_.emplace_back([job]()->void { (*job)(); }, origin);
+        pending_tasks_.fetch_add(1, std::memory_order_relaxed);
     }
 
     //通过写管道唤醒轮询函数
@@ -289,27 +367,135 @@ EventPoller::Task::Ptr EventPoller::async_first(EventPoller::TaskIn&& task, bool
     return job;
 }
 
-EventPoller::DelayTask::Ptr EventPoller::addDelayTask(int delayMs, OnDelay &&onDelay) {
+std::vector<EventPoller::Task::Ptr> EventPoller::asyncBatch(EventPoller::TaskList&& tasks, bool may_sync, TaskOrigin origin) {
+    std::vector<Task::Ptr> jobs;
+    if (may_sync && currentThread()) {
+        for (auto& task : tasks) {
+            if (task) task();
+        }
+        return jobs;
+    }
+
+    //空任务对应nullptr，句柄与tasks一一对应
+    jobs.reserve(tasks.size());
+    size_t count = 0;
+    for (auto& task : tasks) {
+        jobs.push_back(task ? Task::create(std::move(task)) : nullptr);
+        count += jobs.back() ? 1 : 0;
+    }
+    if (!count) return jobs;
+
+    {
+        LOCK_GUARD(tasks_mutex_);
+        for (auto& job : jobs) {
+            if (job) tasks_.emplace_back([job]()->void { (*job)(); }, origin);
+        }
+        pending_tasks_.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    //所有任务入队后，仅写一次管道唤醒轮询函数
+    writePipe();
+    return jobs;
+}
+
+void EventPoller::post(InlineTask&& task, bool may_sync, TaskOrigin origin) {
+    if (!task) return;
+
+    if (may_sync && currentThread()) {
+        task();
+        return;
+    }
+
+    {
+        LOCK_GUARD(tasks_mutex_);
+        tasks_.emplace_back(std::move(task), origin);
+        pending_tasks_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //通过写管道唤醒轮询函数
+    writePipe();
+}
+
+EventPoller::DelayTask::Ptr EventPoller::addDelayTask(int delayMs, OnDelay &&onDelay, int slackMs, DelaySchedule schedule) {
     //创建延迟任务
     auto delayTask = DelayTask::create(std::move(onDelay));
     if (delayTask == nullptr) return delayTask;
 
-    //添加定时器这个时刻作为开始时间
-    auto deadline = getCurrentMillisecond() + delayMs;
+    /**
+     * 添加定时器这个时刻作为开始时间
+     *      在本轮询线程的回调中添加时，使用缓存的当前时间（即回调开始执行的时间）
+    */
+    uint32_t slack = slackMs > 0 ? slackMs : 0;
+    auto deadline = (s_running_poller == this ? nowMillisecond() : clockMicrosecond() / 1000) + delayMs;
     /**
      * 借助异步任务的两个作用： 
      *      （1）唤醒轮询函数，因为没有延迟任务的时候是永久等待
      *              异步任务执行完成后，轮询线程, 首先会调用延迟任务(scheduleDelayTask)
      *       (2) 添加异步任务时，不需要加锁
     */
-    async_first([deadline, delayTask, this]()->void {
-        delay_tasks_.emplace(deadline, delayTask);
+    async_first([deadline, slack, schedule, delayTask, this]()->void {
+        delay_tasks_.emplace(alignDeadline(deadline, slack), DelayRecord(delayTask, slack, schedule, deadline));
     });
 
     //返回定时任务
     return delayTask;
 }
 
+EventPoller::DelayTask::Ptr EventPoller::addHighResDelayTask(uint64_t delayUs, OnDelay &&onDelay, DelaySchedule schedule) {
+#if HAS_TIMERFD
+    auto delayTask = DelayTask::create(std::move(onDelay));
+    if (delayTask == nullptr) return delayTask;
+
+    auto deadline = (s_running_poller == this ? now() : clockMicrosecond()) + delayUs;
+    async_first([deadline, schedule, delayTask, this]()->void {
+        highres_tasks_.emplace(deadline, DelayRecord(delayTask, 0, schedule, deadline));
+        if (!clock_ && (!timer_fd_deadline_ || deadline < timer_fd_deadline_)) {
+            armTimerFd(deadline);
+        }
+    });
+    return delayTask;
+#else
+    //不支持timerfd：退化为毫秒定时器，回调返回的微秒延迟同样向上取整
+    auto onDelayUs = std::make_shared<OnDelay>(std::move(onDelay));
+    return addDelayTask((int)((delayUs + 999) / 1000), [onDelayUs]()->uint64_t {
+        return ((*onDelayUs)() + 999) / 1000;
+    }, 0, schedule);
+#endif
+}
+
+
+void EventPoller::setClock(const PollerClock::Ptr &clock) {
+    clock_ = clock;
+    setNow(EventPollerStats::now());
+    if (clock_) {
+        clock_->attach(shared_from_this());
+    }
+}
+
+uint64_t EventPoller::onClockChanged() {
+    uint64_t next = UINT64_MAX;
+    Semphore done;
+    async([this, &next, &done]()->void {
+        setNow(clock_->nowMicrosecond());
+        scheduleDelayTask();
+        if (!delay_tasks_.empty()) {
+            next = delay_tasks_.begin()->first * 1000;
+        }
+#if HAS_TIMERFD
+        runHighResDelayTask(now());
+        if (!highres_tasks_.empty()) {
+            next = std::min(next, highres_tasks_.begin()->first);
+        }
+#endif
+        done.post();
+    });
+    done.wait();
+    return next;
+}
+
+EventPoller::Ptr EventPoller::getCurrentPoller() {
+    return s_current_poller.lock();
+}
 
 BufferRaw::Ptr EventPoller::getSharedBuffer() {
     auto ret = shared_buffer_.lock();
@@ -332,6 +518,16 @@ EventPoller::EventPoller() :tasks_mutex_(true), event_records_mutex_(false) {
     SockUtil::setCloOnExec(epoll_fd_);
 #endif
     attachPipeEvent();
+
+#if HAS_TIMERFD
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ == -1) {
+        throw std::runtime_error((StrPrinter << "Failed to create timerfd: " << get_uv_errmsg()));
+    }
+    attachEvent(timer_fd_, Event::kEventRead, [this](int) {
+        onTimerFdEvent();
+    });
+#endif
 }
 
 void EventPoller::writePipe() {
@@ -357,36 +553,41 @@ int64_t EventPoller::scheduleDelayTask() {
     
     /**
      * 以当前时间节点计算延迟任务是否到期
+     *      上一个回调结束或本次唤醒时已更新now()，不需要再读取时钟
     */
-    auto currentMillisecond = getCurrentMillisecond();
+    auto currentMillisecond = nowMillisecond();
 
     //没有延迟任务
     if (delay_tasks_.empty()) return 0;
 
 
-    decltype(delay_tasks_) delay_tasks_copy;
-    delay_tasks_copy.swap(delay_tasks_);
+    /**
+     * multimap<uint64_t, XX>是按照, 延迟任务超时时间递增的
+     *      只取出到期的延迟任务，未到期的保留在delay_tasks_中，定时器数量很多时不需要每次重新插入全部定时器
+     *      到期回调中添加的延迟任务（轮询线程中async_first同步执行）直接插入delay_tasks_，不影响本次执行
+    */
+    auto end = delay_tasks_.upper_bound(currentMillisecond);
+    for (auto it = delay_tasks_.begin(); it != end; ++it) {
+        delay_expired_.emplace_back(std::move(it->second));
+    }
+    delay_tasks_.erase(delay_tasks_.begin(), end);
 
-    //multimap<uint64_t, XX>是按照, 延迟任务超时时间递增的
-    for (auto it = delay_tasks_copy.begin(); it != delay_tasks_copy.end() && it->first <= currentMillisecond; it = delay_tasks_copy.erase(it)) {
+    uint64_t fired = 0;
+    for (auto &record : delay_expired_) {
         //此处说明，延迟任务到期了
-        if (it->second && (*(it->second))) {
-            auto delayMs = (*(it->second))();
-            if (delayMs > 0) {
-                //延迟任务，继续保持
-                delay_tasks_.emplace(currentMillisecond + delayMs, it->second);
-            }
-        }
+        fired += runDelayTask(delay_tasks_, record, currentMillisecond, 1000);
     }
-
-    //未执行完成的延迟任务
-    delay_tasks_.insert(delay_tasks_copy.begin(), delay_tasks_copy.end());
+    delay_expired_.clear();
+    stats_.timers.add(fired);
+    stats_.timers_per_loop.record(fired);
 
     if (delay_tasks_.empty()) {
         return 0;
     }
 
-    return delay_tasks_.begin()->first - currentMillisecond;
+    //到期回调中添加的0延迟任务已经到期，不能返回0(永久阻塞)
+    auto first = delay_tasks_.begin()->first;
+    return first > currentMillisecond ? first - currentMillisecond : 1;
 
 #if 0
     /**
@@ -422,6 +623,85 @@ int64_t EventPoller::scheduleDelayTask() {
 #endif
 }
 
+uint64_t EventPoller::runDelayTask(DelayMap &tasks, DelayRecord &record, uint64_t now, uint64_t usecPerUnit) {
+    uint64_t fired = 0;
+    auto &task = record.task_;
+    while (task && (*task)) {
+        ++fired;
+        stats_.timer_late_usec.record((now - record.deadline_) * usecPerUnit);
+        auto period = (*task)();
+        if (period == 0 || !(*task)) {
+            //不再重复执行（或执行过程中被取消），释放可调用对象
+            task->finish();
+            break;
+        }
+
+        uint64_t skipped = 0;
+        record.deadline_ = record.schedule_.next(record.deadline_, now, period, skipped);
+        if (skipped) {
+            stats_.timers_skipped.add(skipped);
+        }
+        if (record.deadline_ > now) {
+            //延迟任务，继续保持
+            tasks.emplace(alignDeadline(record.deadline_, record.slack_ms_), std::move(record));
+            break;
+        }
+        //kFixedRate错过的周期，立即补执行
+    }
+    return fired;
+}
+
+#if HAS_TIMERFD
+void EventPoller::onTimerFdEvent() {
+    //读取到期次数，清除可读状态
+    uint64_t expirations = 0;
+    if (-1 == ::read(timer_fd_, &expirations, sizeof(expirations)) && UV_EAGAIN != get_uv_error()) {
+        WarnL << "read timerfd failed: " << get_uv_errmsg();
+    }
+    timer_fd_deadline_ = 0;
+
+    //亚毫秒定时器不使用缓存的唤醒时间，重新读取时钟
+    setNow(EventPollerStats::now());
+    runHighResDelayTask(now());
+
+    if (!highres_tasks_.empty()) {
+        armTimerFd(highres_tasks_.begin()->first);
+    }
+}
+
+void EventPoller::runHighResDelayTask(uint64_t now) {
+    //与scheduleDelayTask相同，只取出到期的任务，回调中添加的任务直接插入highres_tasks_
+    auto end = highres_tasks_.upper_bound(now);
+    for (auto it = highres_tasks_.begin(); it != end; ++it) {
+        highres_expired_.emplace_back(std::move(it->second));
+    }
+    highres_tasks_.erase(highres_tasks_.begin(), end);
+
+    uint64_t fired = 0;
+    for (auto &record : highres_expired_) {
+        fired += runDelayTask(highres_tasks_, record, now, 1);
+    }
+    highres_expired_.clear();
+    stats_.timers.add(fired);
+}
+
+void EventPoller::armTimerFd(uint64_t deadline) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (deadline) {
+        //程序启动时间加上起点，转换为CLOCK_MONOTONIC绝对时间；it_value全0表示停止
+        auto ns = deadline * 1000 + getMonotonicOrigin();
+        spec.it_value.tv_sec = ns / 1000000000ULL;
+        spec.it_value.tv_nsec = ns % 1000000000ULL;
+    }
+    if (-1 == timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr)) {
+        WarnL << "timerfd_settime failed: " << get_uv_errmsg();
+        return;
+    }
+    timer_fd_deadline_ = deadline;
+}
+#endif
+
 void EventPoller::onPipeEvent() {
     char buffer[1024];
     //pipe读事件，需要读完管道数据
@@ -446,38 +726,95 @@ void EventPoller::onPipeEvent() {
         break;
     }
  
-    decltype(tasks_) tmp;
     {
         LOCK_GUARD(tasks_mutex_);
-        if (tasks_.empty()) return;
-        tasks_.swap(tmp);
+        if (tasks_.empty() && tasks_first_.empty()) return;
+        tasks_.swap(tasks_running_);
+        tasks_first_.swap(tasks_first_running_);
     }
 
-    for (auto& task : tmp) {
-        if (task && (*task)) {
+    //async_first投递的任务，后投递的先执行
+    auto now = statsNow();
+    for (auto it = tasks_first_running_.rbegin(); it != tasks_first_running_.rend(); ++it) {
+        now = runQueuedTask(*it, now);
+    }
+    for (auto& task : tasks_running_) {
+        now = runQueuedTask(task, now);
+    }
 
-            try {
-                (*task)();
-            }
-            catch (Exit&) {
-                exit_ = true;
+    auto count = tasks_first_running_.size() + tasks_running_.size();
+    pending_tasks_.fetch_sub(count, std::memory_order_relaxed);
+    stats_.tasks.add(count);
+    stats_.tasks_per_loop.record(count);
+    //保留容量，下次交换时复用
+    tasks_first_running_.clear();
+    tasks_running_.clear();
+}
 
-                /**
-                * 线程内部不能join自己
-                */
-                /*if (thread_ && thread_->joinable()) {
-                    thread_->join();
-                    thread_ = nullptr;
-                }*/
+void EventPoller::runTask(InlineTask &task) {
+    if (!task) return;
 
-            }
-            catch (...) {
-                //其他异常忽略
-                continue;
-            }
-            
-        }
+    try {
+        task();
+    }
+    catch (Exit&) {
+        exit_ = true;
+
+        /**
+        * 线程内部不能join自己
+        */
+        /*if (thread_ && thread_->joinable()) {
+            thread_->join();
+            thread_ = nullptr;
+        }*/
+    }
+    catch (...) {
+        //其他异常忽略
+    }
+}
+
+uint64_t EventPoller::runQueuedTask(QueuedTask &task, uint64_t now) {
+    stats_.task_delay_usec.record(now > task.enqueue_time_ ? now - task.enqueue_time_ : 0);
+    runTask(task.task_);
+
+    auto end = EventPollerStats::now();
+    setNow(end);
+    auto usec = end - now;
+    stats_.task_usec.record(usec);
+    auto budget = slow_task_usec_.load(std::memory_order_relaxed);
+    if (budget && usec > budget) {
+        reportSlow(StrPrinter << "task, posted at " << task.origin_.file << ":" << task.origin_.line, usec, budget, end);
+    }
+    return end;
+}
+
+void EventPoller::onLoopEnd(uint64_t wakeupTime, uint64_t now) {
+    //第一次轮询之前没有唤醒时间
+    if (!wakeupTime) return;
+
+    auto usec = now - wakeupTime;
+    stats_.loop_usec.record(usec);
+    auto budget = slow_loop_usec_.load(std::memory_order_relaxed);
+    if (budget && usec > budget) {
+        reportSlow("poller iteration", usec, budget, now);
+    }
+}
+
+void EventPoller::reportSlow(const std::string &what, uint64_t usec, uint64_t budget, uint64_t now) {
+    stats_.slow.add();
+
+    if (slow_log_time_ && now - slow_log_time_ < SLOW_LOG_INTERVAL_USEC) {
+        ++slow_suppressed_;
+        return;
+    }
+
+    std::string suppressed;
+    if (slow_suppressed_) {
+        suppressed = StrPrinter << ", " << slow_suppressed_ << " more suppressed";
     }
+    WarnL << "Slow " << what << " took " << usec << "us (budget " << budget << "us)" << suppressed;
+    slow_log_time_ = now;
+    slow_suppressed_ = 0;
 }
 
 void EventPoller::attachPipeEvent() {
@@ -522,7 +859,9 @@ int EventPoller::attachEvent_l(int fd, EventRecord::Ptr eventRecord) {
             return -1;
         }
 #endif
+        eventRecord->fd_ = fd;
         event_records_[fd] = eventRecord;
+        event_count_.store(event_records_.size(), std::memory_order_relaxed);
         return ret;
     }
 
@@ -2,13 +2,18 @@
 #define POLLER_EVENTPOLLER_H
 
 #include <thread>
+#include <atomic>
 #include <memory>
 #include <list>
 #include <unordered_map>
 #include <map>
+#include <vector>
 
 #include "thread/TaskExecutor.h"
 #include "poller/PipeWrapper.h"//使用PipeWrapper，支持写Pipe唤醒轮询函数（select或epoll_wait)
+#include "poller/EventPollerStats.h"
+#include "poller/DelaySchedule.h"
+#include "poller/PollerClock.h"
 #include "util/MutexWrapper.h"
 #include "util/Nocopyable.h"
 #include "network/Buffer.h"
@@ -21,19 +26,42 @@
 #if HAS_EPOLL
 
 #define EPOLL_SIZE 1024
-#define TO_EPOLL_EVENT(events)  ((events) & avc::util::EventPoller::Event::kEventRead) ? EPOLLIN : 0 \
-                               |((events) & avc::util::EventPoller::Event::kEventWrite) ? EPOLLOUT : 0 \
-                               |((events) & avc::util::EventPoller::Event::kEventError) ? EPOLLERR : 0
+#define TO_EPOLL_EVENT(events)  ((((events) & avc::util::EventPoller::Event::kEventRead) ? EPOLLIN : 0) \
+                               |(((events) & avc::util::EventPoller::Event::kEventWrite) ? EPOLLOUT : 0) \
+                               |(((events) & avc::util::EventPoller::Event::kEventError) ? EPOLLERR : 0))
 
-#define TO_POLLER_EVENT(events) ((events) & EPOLLIN) ? avc::util::EventPoller::Event::kEventRead : 0 \
-                               |((events) & EPOLLOUT) ? avc::util::EventPoller::Event::kEventWrite : 0 \
-                               |((events) & EPOLLERR) ? avc::util::EventPoller::Event::kEventError : 0 
+#define TO_POLLER_EVENT(events) ((((events) & EPOLLIN) ? avc::util::EventPoller::Event::kEventRead : 0) \
+                               |(((events) & EPOLLOUT) ? avc::util::EventPoller::Event::kEventWrite : 0) \
+                               |(((events) & EPOLLERR) ? avc::util::EventPoller::Event::kEventError : 0))
 #endif
 
+/**
+ * 高精度定时器使用timerfd（仅Linux）
+*/
+#if HAS_EPOLL && defined(__linux__)
+#define HAS_TIMERFD 1
+#else
+#define HAS_TIMERFD 0
+#endif
+
+/**
+ * 慢回调检测的默认预算，单位微秒
+ *      单次轮询（从唤醒到再次休眠）、单个fd事件回调、单个异步任务
+*/
+#define SLOW_LOOP_USEC          (50 * 1000)
+#define SLOW_CALLBACK_USEC      (10 * 1000)
+#define SLOW_TASK_USEC          (10 * 1000)
+/**
+ * 慢回调日志的最小间隔，间隔内的其他慢回调只计数
+*/
+#define SLOW_LOG_INTERVAL_USEC  (1000 * 1000)
+
 
 namespace avc {
 namespace util {
 
+class CoarseTimerWheel;
+
 /**
  * 事件轮询: 通过调用select或epoll_wait接口，轮询网络I/O时间或者定时器事件
 */
@@ -58,8 +86,9 @@ public:
     /**
      * 毫秒级别定时器实现
      * uint64_t回调函数返回延迟时间
+     *      使用原子状态字实现取消，周期执行时不需要weak_ptr::lock
     */
-    using DelayTask = TaskCancelableImpl<uint64_t()>;
+    using DelayTask = TaskCancelableAtomic<uint64_t()>;
     using OnDelay = std::function<uint64_t()>;
 
 
@@ -92,16 +121,110 @@ public:
      *          1）对于Window平台，轮询函数需要网络套接字才能唤醒，因此管道需要使用套接字模拟实现
      *          2）对于Linux平台，轮询函数使用文件描述符唤醒，因此使用管道即可
     */
-    Task::Ptr async(TaskIn&& task, bool may_sync = true) override;
-    Task::Ptr async_first(TaskIn&& task, bool may_sync = true) override;
+    Task::Ptr async(TaskIn&& task, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) override;
+    Task::Ptr async_first(TaskIn&& task, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) override;
+    /**
+     * 批量投递异步任务：任务队列仅加锁一次，管道仅写一次
+     *      用于一次性向同一EventPoller派发大量任务（例如一帧数据扇出到多个Socket）
+    */
+    std::vector<Task::Ptr> asyncBatch(TaskList&& tasks, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) override;
+    /**
+     * 不返回取消句柄的异步任务，InlineTask直接放入任务队列
+    */
+    void post(InlineTask&& task, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) override;
 
     /**
      * 添加延迟任务
+     *      在本轮询线程中调用时，以now()作为开始时间，不再读取时钟
+     * @param slackMs 允许推迟执行的时间，单位毫秒，0表示精确到毫秒
+     *                到期时间向上对齐到slackMs的整数倍，即在[到期时间, 到期时间 + slackMs)内执行；
+     *                slack相同的定时器落在同一时刻，一次唤醒全部执行，大量定时器时减少唤醒次数
+     *                周期执行时，每次重新计算的到期时间同样对齐
+     * @param schedule 周期执行时的重新调度方式，默认kFixedDelay（以本次执行时间计算下一次到期时间），
+     *                 kFixedRate以到期时间计算，没有累积误差，见DelaySchedule
+    */
+    DelayTask::Ptr addDelayTask(int delayMs, OnDelay &&onDelay, int slackMs = 0, DelaySchedule schedule = DelaySchedule()); 
+    /**
+     * 添加高精度延迟任务，单位微秒，用于RTP发送节奏控制等亚毫秒级定时
+     *      通过timerfd(CLOCK_MONOTONIC，TFD_TIMER_ABSTIME)唤醒轮询线程，不受epoll_wait毫秒超时的限制
+     *      onDelay返回下一次的延迟时间，单位微秒，返回0表示不再执行；取消方式与addDelayTask相同
+     *      不支持timerfd的平台退化为毫秒定时器（延迟时间向上取整到毫秒）
+     * @param schedule 同addDelayTask，发送节奏控制通常使用kFixedRate
     */
-    DelayTask::Ptr addDelayTask(int delayMs, OnDelay &&onDelay); 
+    DelayTask::Ptr addHighResDelayTask(uint64_t delayUs, OnDelay &&onDelay, DelaySchedule schedule = DelaySchedule());
+
+    /**
+     * 设置时钟源，应在添加定时器与runLoop之前调用，默认使用单调时钟（getCurrentMicrosecond）
+     *      使用VirtualClock时，now()与所有定时器（包括CoarseTimer与高精度定时器）只随VirtualClock推进，
+     *      测试与性能测试中可以手动推进时间，见VirtualClock
+    */
+    void setClock(const PollerClock::Ptr &clock);
+
+    /**
+     * 轮询线程缓存的当前时间，单位微秒，与getCurrentMicrosecond为同一时钟（设置了时钟源时为时钟源的时间）
+     *      每次唤醒、每个fd事件回调与异步任务执行结束后更新，读取只是一次内存访问
+     *      在回调中读取时，得到的是该回调开始执行的时间（定时器回调中为本轮定时器调度开始的时间）
+     *      非轮询线程也可以读取，得到的是最近一次更新的时间，轮询线程休眠期间不再更新
+    */
+    uint64_t now() const {
+        return now_usec_.load(std::memory_order_relaxed);
+    }
+    uint64_t nowMillisecond() const {
+        return now() / 1000;
+    }
 
     BufferRaw::Ptr getSharedBuffer();
+
+    /**
+     * 任务队列中等待执行的任务数量（不加锁，近似值）
+    */
+    size_t pendingTaskCount() const override {
+        return pending_tasks_.load(std::memory_order_relaxed);
+    }
+    /**
+     * 已注册的I/O事件数量（包含内部唤醒管道）
+    */
+    size_t eventCount() const override {
+        return event_count_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * 调用线程是否为本EventPoller的轮询线程
+    */
+    bool isCurrentThread() const {
+        return currentThread();
+    }
+
+    /**
+     * 获取调用线程所属的EventPoller，非轮询线程返回nullptr
+    */
+    static EventPoller::Ptr getCurrentPoller();
+
+    /**
+     * 热路径统计：轮询线程写入，任意线程读取
+    */
+    const EventPollerStats &getStats() const {
+        return stats_;
+    }
+    std::string dumpStats(const std::string &prefix = "") const {
+        return stats_.dump(prefix);
+    }
+
+    /**
+     * 设置慢回调检测预算，单位微秒，0表示不检测对应项
+     *      轮询线程在每次轮询、fd事件回调、异步任务结束后与预算比较（统计时已获取耗时，没有额外开销），
+     *      超出预算时记录fd或任务投递位置(async调用处的源文件与行号)，通过日志模块限频输出
+     *  可在任意线程调用
+    */
+    void setSlowBudget(uint64_t loopUsec, uint64_t callbackUsec, uint64_t taskUsec) {
+        slow_loop_usec_.store(loopUsec, std::memory_order_relaxed);
+        slow_callback_usec_.store(callbackUsec, std::memory_order_relaxed);
+        slow_task_usec_.store(taskUsec, std::memory_order_relaxed);
+    }
 private:
+    friend class VirtualClock;
+    friend class CoarseTimerWheel;
+
     EventPoller();
     /**
      * EventPoller::runLoop执行任务时，捕获退出异常，从而完成退出操作
@@ -110,6 +233,33 @@ private:
 
     };//class Exit
 
+    /**
+     * 任务队列中的任务，记录投递时间用于统计排队时间
+    */
+    struct QueuedTask {
+        QueuedTask(InlineTask &&task, const TaskOrigin &origin)
+            : task_(std::move(task)), origin_(origin), enqueue_time_(EventPollerStats::now()) {}
+
+        InlineTask task_;
+        TaskOrigin origin_;
+        uint64_t enqueue_time_;
+    };//struct QueuedTask
+
+    /**
+     * 延迟任务
+     *      以slack对齐后的到期时间排序；deadline_为对齐前的到期时间，用于计算下一个周期与统计执行延迟
+    */
+    struct DelayRecord {
+        DelayRecord(DelayTask::Ptr task, uint32_t slackMs, const DelaySchedule &schedule, uint64_t deadline)
+            : task_(std::move(task)), slack_ms_(slackMs), schedule_(schedule), deadline_(deadline) {}
+
+        DelayTask::Ptr task_;
+        uint32_t slack_ms_;
+        DelaySchedule schedule_;
+        uint64_t deadline_;
+    };//struct DelayRecord
+    using DelayMap = std::multimap<uint64_t, DelayRecord>;
+
     /**
      * writePipe仅仅用于唤醒轮询函数，写入的数据目前没有定义格式
     */
@@ -123,12 +273,77 @@ private:
      *         -1代表没有定时任务
     */
     int64_t scheduleDelayTask();
+    /**
+     * 执行一个到期的延迟任务，按调度方式重新加入tasks；kFixedRate错过周期时在此连续补执行
+     * @param now 本次调度的当前时间，与到期时间单位相同
+     * @param usecPerUnit 时间单位对应的微秒数，用于统计执行延迟
+     * @return 返回执行次数
+    */
+    uint64_t runDelayTask(DelayMap &tasks, DelayRecord &record, uint64_t now, uint64_t usecPerUnit);
 
     /**
      * 管道也属于文件I/O事件
     */
     void onPipeEvent(); 
+    /**
+     * 执行单个任务，处理Exit退出异常
+    */
+    void runTask(InlineTask &task);
+    /**
+     * 执行任务并统计排队时间与执行耗时
+     * @param now 开始执行的时间，返回执行结束的时间
+    */
+    uint64_t runQueuedTask(QueuedTask &task, uint64_t now);
+    /**
+     * 一次轮询结束（即将休眠）时调用，统计并检测本次轮询耗时
+    */
+    void onLoopEnd(uint64_t wakeupTime, uint64_t now);
+    /**
+     * 超出预算时输出日志，SLOW_LOG_INTERVAL_USEC内最多输出一条
+     * @param what 超时项以及fd或任务投递位置
+    */
+    void reportSlow(const std::string &what, uint64_t usec, uint64_t budget, uint64_t now);
     void attachPipeEvent();
+#if HAS_TIMERFD
+    /**
+     * timerfd可读：执行到期的高精度延迟任务，并按最近的到期时间重新设置timerfd
+    */
+    void onTimerFdEvent();
+    /**
+     * 执行到期的高精度延迟任务
+     * @param now 当前时间，单位微秒
+    */
+    void runHighResDelayTask(uint64_t now);
+    /**
+     * 设置timerfd的到期时间（程序启动时间，单位微秒），0表示停止
+    */
+    void armTimerFd(uint64_t deadline);
+#endif
+    /**
+     * 更新缓存的当前时间，仅轮询线程调用
+     * @param now 刚读取的真实时间，设置了时钟源时改为读取时钟源
+    */
+    void setNow(uint64_t now) {
+        now_usec_.store(clock_ ? clock_->nowMicrosecond() : now, std::memory_order_relaxed);
+    }
+    /**
+     * 统计耗时的开始时间（真实时钟，与EventPollerStats::now()相同）
+     *      未设置时钟源时即缓存的now()，不读取时钟；设置了时钟源时now()为时钟源的时间，需要读取真实时钟
+    */
+    uint64_t statsNow() const {
+        return clock_ ? EventPollerStats::now() : now();
+    }
+    /**
+     * 非轮询线程添加定时器时的开始时间，单位微秒
+    */
+    uint64_t clockMicrosecond() const {
+        return clock_ ? clock_->nowMicrosecond() : getCurrentMicrosecond();
+    }
+    /**
+     * VirtualClock的时间改变后调用：在轮询线程中（未运行时在调用线程中）执行到期的定时器，等待执行完成
+     * @return 返回最近的定时器到期时间，单位微秒，没有定时器时返回UINT64_MAX
+    */
+    uint64_t onClockChanged();
 
     /**
      * 注册文件I/O事件，以及回调函数
@@ -152,7 +367,7 @@ private:
             return events_ & Event::kEventError;
         }
 
-        //FD fd_;
+        FD fd_ = -1;
         /**
          * 文件描述符关心的事件类型
         */
@@ -173,26 +388,70 @@ private:
 
     /**
     * 任务队列
+    *      tasks_first_保存async_first投递的任务，逆序执行，且先于tasks_执行
+    *      tasks_running_/tasks_first_running_仅由轮询线程访问，与任务队列交换后执行，
+    *      执行完成后clear保留容量，稳定运行后任务队列不再申请内存
     */
-    std::list<Task::Ptr> tasks_;
+    std::vector<QueuedTask> tasks_;
+    std::vector<QueuedTask> tasks_first_;
+    std::vector<QueuedTask> tasks_running_;
+    std::vector<QueuedTask> tasks_first_running_;
     MutexWrapper<std::mutex> tasks_mutex_;
+    std::atomic<size_t> pending_tasks_{0};
 
     /**
      * 注册的网络I/O事件记录
     */
     std::unordered_map<FD, EventRecord::Ptr> event_records_;
     MutexWrapper<std::mutex> event_records_mutex_;
+    std::atomic<size_t> event_count_{0};
     PipeWrapper pipe_;
 
 
     /**
      * 延迟任务
     */
-    std::multimap<uint64_t, DelayTask::Ptr> delay_tasks_;
+    DelayMap delay_tasks_;
+    /**
+     * 本次调度中到期的延迟任务，仅由轮询线程访问，clear后保留容量
+    */
+    std::vector<DelayRecord> delay_expired_;
+#if HAS_TIMERFD
+    /**
+     * 高精度延迟任务，以微秒到期时间排序，仅由轮询线程访问
+    */
+    int timer_fd_ = -1;
+    uint64_t timer_fd_deadline_ = 0;//timerfd当前的到期时间，0表示未设置
+    DelayMap highres_tasks_;
+    std::vector<DelayRecord> highres_expired_;
+#endif
 #if HAS_EPOLL
     int epoll_fd_ = -1;
 #endif
     std::weak_ptr<BufferRaw> shared_buffer_;
+    /**
+     * CoarseTimer的时间轮，第一次启动CoarseTimer时在轮询线程中创建，仅由轮询线程访问
+    */
+    std::shared_ptr<CoarseTimerWheel> coarse_timer_wheel_;
+
+    EventPollerStats stats_;
+    /**
+     * 缓存的当前时间，轮询线程写入，任意线程读取
+    */
+    std::atomic<uint64_t> now_usec_{0};
+    /**
+     * 时钟源，nullptr表示单调时钟
+    */
+    PollerClock::Ptr clock_;
+
+    /**
+     * 慢回调检测
+    */
+    std::atomic<uint64_t> slow_loop_usec_{SLOW_LOOP_USEC};
+    std::atomic<uint64_t> slow_callback_usec_{SLOW_CALLBACK_USEC};
+    std::atomic<uint64_t> slow_task_usec_{SLOW_TASK_USEC};
+    uint64_t slow_log_time_ = 0;//上次输出慢回调日志的时间
+    uint64_t slow_suppressed_ = 0;//上次输出后被限频的慢回调数量
 };//class EventPoller
 
 }//namespace util
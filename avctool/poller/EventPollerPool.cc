@@ -18,6 +18,24 @@ EventPoller::Ptr EventPollerPool::getEventPoller() {
     return std::static_pointer_cast<EventPoller>(getTaskExecutor());
 }
 
+std::vector<EventPoller::Ptr> EventPollerPool::getEventPollers() const {
+    std::vector<EventPoller::Ptr> pollers;
+    pollers.reserve(task_executors_.size());
+    for (auto &executor : task_executors_) {
+        pollers.push_back(std::static_pointer_cast<EventPoller>(executor));
+    }
+    return pollers;
+}
+
+std::string EventPollerPool::dumpStats() const {
+    std::string stats;
+    for (size_t index = 0; index < task_executors_.size(); ++index) {
+        auto poller = std::static_pointer_cast<EventPoller>(task_executors_[index]);
+        stats += poller->dumpStats(StrPrinter << "poller" << index << "_");
+    }
+    return stats;
+}
+
 
 EventPollerPool::EventPollerPool() {
     int hardware_concurrency = std::thread::hardware_concurrency();
@@ -31,6 +31,14 @@ public:
     static EventPollerPool &instance();
 
     EventPoller::Ptr getEventPoller();
+    /**
+     * 获取所有EventPoller，例如用于SocketRebalancer
+    */
+    std::vector<EventPoller::Ptr> getEventPollers() const;
+    /**
+     * 输出所有EventPoller的统计项，每个EventPoller以"poller<下标>_"作为前缀
+    */
+    std::string dumpStats() const;
 private:
     EventPollerPool();
 
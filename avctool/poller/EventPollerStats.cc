@@ -0,0 +1,105 @@
+#include "EventPollerStats.h"
+
+#include <sstream>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace avc {
+namespace util {
+
+int LatencyHistogram::indexOf(uint64_t value) {
+    if (value < (uint64_t)kSubBucketCount) {
+        return (int)value;
+    }
+
+    //最高位所在位置，决定所属的2的幂区间
+#if defined(_MSC_VER)
+    unsigned long msb = 0;
+    _BitScanReverse64(&msb, value);
+#else
+    int msb = 63 - __builtin_clzll(value);
+#endif
+    if ((int)msb > kMaxBits) {
+        return kBucketCount - 1;
+    }
+    int shift = (int)msb - kSubBucketBits;
+    int sub = (int)(value >> shift) - kSubBucketCount;
+    return (shift + 1) * kSubBucketCount + sub;
+}
+
+uint64_t LatencyHistogram::lowerBound(int index) {
+    int octave = index / kSubBucketCount;
+    uint64_t sub = index % kSubBucketCount;
+    if (octave == 0) {
+        return sub;
+    }
+    return (kSubBucketCount + sub) << (octave - 1);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.buckets.resize(kBucketCount);
+    for (int index = 0; index < kBucketCount; ++index) {
+        snapshot.buckets[index] = buckets_[index].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[index];
+    }
+    //总数由各个桶累加得到，记录时不需要单独维护
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double percent) const {
+    if (count == 0) return 0;
+
+    uint64_t target = (uint64_t)(count * percent / 100.0);
+    if (target >= count) target = count - 1;
+
+    uint64_t seen = 0;
+    for (size_t index = 0; index < buckets.size(); ++index) {
+        seen += buckets[index];
+        if (seen > target) {
+            auto upper = lowerBound((int)index + 1) - 1;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+static void dumpHistogram(std::ostream &out, const std::string &name, const LatencyHistogram &histogram) {
+    auto snapshot = histogram.snapshot();
+    out << name
+        << " count=" << snapshot.count
+        << " mean=" << snapshot.mean()
+        << " p50=" << snapshot.percentile(50)
+        << " p90=" << snapshot.percentile(90)
+        << " p99=" << snapshot.percentile(99)
+        << " p999=" << snapshot.percentile(99.9)
+        << " max=" << snapshot.max
+        << "\n";
+}
+
+std::string EventPollerStats::dump(const std::string &prefix) const {
+    std::ostringstream out;
+    out << prefix << "loops " << loops.value() << "\n";
+    out << prefix << "events " << events.value() << "\n";
+    out << prefix << "tasks " << tasks.value() << "\n";
+    out << prefix << "timers " << timers.value() << "\n";
+    out << prefix << "timers_skipped " << timers_skipped.value() << "\n";
+    out << prefix << "slow " << slow.value() << "\n";
+
+    dumpHistogram(out, prefix + "loop_usec", loop_usec);
+    dumpHistogram(out, prefix + "wait_usec", wait_usec);
+    dumpHistogram(out, prefix + "callback_usec", callback_usec);
+    dumpHistogram(out, prefix + "task_delay_usec", task_delay_usec);
+    dumpHistogram(out, prefix + "task_usec", task_usec);
+    dumpHistogram(out, prefix + "timer_late_usec", timer_late_usec);
+    dumpHistogram(out, prefix + "events_per_loop", events_per_loop);
+    dumpHistogram(out, prefix + "tasks_per_loop", tasks_per_loop);
+    dumpHistogram(out, prefix + "timers_per_loop", timers_per_loop);
+    return out.str();
+}
+
+}
+}
@@ -0,0 +1,132 @@
+#ifndef POLLER_EVENTPOLLERSTATS_H
+#define POLLER_EVENTPOLLERSTATS_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "util/Util.h"
+
+namespace avc {
+namespace util {
+
+/**
+ * 单写者计数器
+ *      仅由轮询线程写入，写入使用relaxed的load+store（不需要加锁前缀的原子加），
+ *      其他线程可随时读取
+*/
+class StatCounter {
+public:
+    void add(uint64_t n = 1) {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    uint64_t value() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+private:
+    std::atomic<uint64_t> value_{0};
+};//class StatCounter
+
+/**
+ * HDR风格直方图（对数-线性分桶），单写者多读者
+ *      小于kSubBucketCount的值每个值一个桶；之后每个2的幂区间平均分成kSubBucketCount个桶，
+ *      相对误差不超过1/kSubBucketCount（约6%），记录只需要一次位运算与几次relaxed存储
+ *  通常记录微秒值，也可以记录数量（例如每次唤醒处理的事件数量）
+*/
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+    /**
+     * 最大可区分的值为2^kMaxBits（微秒时约19小时），更大的值记录在最后一个桶
+    */
+    static constexpr int kMaxBits = 36;
+    static constexpr int kBucketCount = (kMaxBits - kSubBucketBits + 2) * kSubBucketCount;
+
+    /**
+     * 直方图快照，由读线程获取
+    */
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        std::vector<uint64_t> buckets;
+
+        uint64_t mean() const { return count ? sum / count : 0; }
+        /**
+         * @param percent 百分位，例如99.9
+         * @return 返回所在桶的上界（不超过max）
+        */
+        uint64_t percentile(double percent) const;
+    };//struct Snapshot
+
+    void record(uint64_t value) {
+        auto &bucket = buckets_[indexOf(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    Snapshot snapshot() const;
+
+    static int indexOf(uint64_t value);
+    /**
+     * 桶的取值区间[lowerBound(index), lowerBound(index + 1))
+    */
+    static uint64_t lowerBound(int index);
+private:
+    std::atomic<uint64_t> buckets_[kBucketCount] = {};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};//class LatencyHistogram
+
+/**
+ * EventPoller热路径统计
+ *      所有统计项仅由轮询线程写入，任意线程通过dump()或各统计项的snapshot()读取
+ *      时间单位均为微秒
+*/
+class EventPollerStats {
+public:
+    /**
+     * 统计使用的单调时钟，单位微秒
+     *      与getCurrentMicrosecond为同一时钟，统计时间与线程负载可以共用
+     *      EventPoller设置了时钟源（PollerClock）时，EventPoller::now()为时钟源的时间，不能与本时钟混用
+    */
+    static uint64_t now() {
+        return getCurrentMicrosecond();
+    }
+
+    /**
+     * 以文本形式输出所有统计项，每行一项，便于采集：
+     *      <prefix>loops 1024
+     *      <prefix>wait_usec count=1024 mean=850 p50=800 p90=1000 p99=1900 p999=1980 max=2001
+    */
+    std::string dump(const std::string &prefix = "") const;
+public:
+    StatCounter loops;              //轮询次数
+    StatCounter events;             //派发的I/O事件数量
+    StatCounter tasks;              //执行的异步任务数量
+    StatCounter timers;             //执行的定时器数量
+    StatCounter timers_skipped;     //kFixedRate定时器超过最大补执行次数后跳过的周期数量
+    StatCounter slow;               //超出预算的轮询、回调与任务数量
+
+    LatencyHistogram loop_usec;     //每次轮询从唤醒到再次休眠的耗时
+
+    LatencyHistogram wait_usec;     //epoll_wait/select阻塞时间
+    LatencyHistogram callback_usec; //每个fd事件回调耗时
+    LatencyHistogram task_delay_usec;//任务从投递到开始执行的排队时间
+    LatencyHistogram task_usec;     //每个异步任务执行耗时
+    LatencyHistogram timer_late_usec;//定时器实际执行时间与到期时间（slack对齐前）的差值，毫秒定时器为毫秒精度
+
+    LatencyHistogram events_per_loop;//每次唤醒派发的I/O事件数量
+    LatencyHistogram tasks_per_loop; //每次处理任务队列时执行的任务数量
+    LatencyHistogram timers_per_loop;//每次调度时执行的定时器数量
+};//class EventPollerStats
+
+}
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include "PollerClock.h"
+
+#include <algorithm>
+
+#include "poller/EventPoller.h"
+
+namespace avc {
+namespace util {
+
+void VirtualClock::attach(const std::shared_ptr<EventPoller> &poller) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pollers_.emplace_back(poller);
+}
+
+void VirtualClock::advance(uint64_t usec) {
+    auto target = nowMicrosecond() + usec;
+    //逐个经过(now, target]内的到期时间，回调中新加入的定时器也在下一次查找中
+    for (auto next = schedule(); next <= target; next = schedule()) {
+        now_.store(std::max(next, nowMicrosecond()), std::memory_order_release);
+    }
+    set(target);
+}
+
+void VirtualClock::set(uint64_t usec) {
+    now_.store(usec ? usec : 1, std::memory_order_release);
+    schedule();
+}
+
+uint64_t VirtualClock::schedule() {
+    std::vector<EventPoller::Ptr> pollers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pollers.reserve(pollers_.size());
+        for (auto it = pollers_.begin(); it != pollers_.end();) {
+            auto poller = it->lock();
+            if (!poller) {
+                it = pollers_.erase(it);
+                continue;
+            }
+            pollers.emplace_back(std::move(poller));
+            ++it;
+        }
+    }
+
+    uint64_t next = UINT64_MAX;
+    for (auto &poller : pollers) {
+        next = std::min(next, poller->onClockChanged());
+    }
+    return next;
+}
+
+}//namespace util
+}//namespace avc
@@ -0,0 +1,88 @@
+#ifndef POLLER_POLLERCLOCK_H
+#define POLLER_POLLERCLOCK_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "util/Util.h"
+
+namespace avc {
+namespace util {
+
+class EventPoller;
+
+/**
+ * EventPoller的时钟源，单位微秒（程序启动时间）
+ *      未设置时钟源时，EventPoller直接读取单调时钟（getCurrentMicrosecond）
+ *      时钟源只决定now()与定时器的到期时间，统计项中的耗时仍使用真实时钟
+*/
+class PollerClock {
+public:
+    using Ptr = std::shared_ptr<PollerClock>;
+
+    virtual ~PollerClock() = default;
+
+    virtual uint64_t nowMicrosecond() const = 0;
+private:
+    friend class EventPoller;
+    /**
+     * EventPoller::setClock时调用
+    */
+    virtual void attach(const std::shared_ptr<EventPoller> &/*poller*/) {}
+};//class PollerClock
+
+/**
+ * 手动推进的虚拟时钟，用于测试与性能测试
+ *      使用虚拟时钟的EventPoller不再按定时器到期时间休眠，也不使用timerfd，
+ *      定时器只在advance/set时由调用线程同步调度，返回时到期的回调都已执行完成
+ *      EventPoller可以不调用runLoop：此时定时器回调直接在调用advance的线程中执行，没有线程切换
+ *  advance/set不能并发调用，也不能在定时器回调中调用
+*/
+class VirtualClock : public PollerClock {
+public:
+    using Ptr = std::shared_ptr<VirtualClock>;
+
+    AVC_STATIC_CREATOR(VirtualClock)
+
+    uint64_t nowMicrosecond() const override {
+        return now_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * 时间推进usec，依次经过期间每个定时器的到期时间：
+     *      每次跳到最近的到期时间并执行到期的定时器，回调中now()即为其到期时间，
+     *      周期定时器在期间的每个周期都会执行，与真实时间流逝的效果相同
+    */
+    void advance(uint64_t usec);
+    /**
+     * 时间跳变：直接设置当前时间，只调度一次
+     *      向前跳过多个周期时，周期定时器按DelaySchedule补执行或跳过错过的周期；
+     *      向后设置时，定时器不会提前执行，也不会重复执行
+    */
+    void set(uint64_t usec);
+private:
+    /**
+     * @param startUsec 初始时间，不能为0（0表示未设置的到期时间）
+    */
+    explicit VirtualClock(uint64_t startUsec = 1000000) : now_(startUsec ? startUsec : 1) {}
+
+    void attach(const std::shared_ptr<EventPoller> &poller) override;
+
+    /**
+     * 在所有EventPoller中执行到期的定时器
+     * @return 返回最近的定时器到期时间，没有定时器时返回UINT64_MAX
+    */
+    uint64_t schedule();
+private:
+    std::atomic<uint64_t> now_;
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<EventPoller>> pollers_;
+};//class VirtualClock
+
+}//namespace util
+}//namespace avc
+
+#endif
@@ -0,0 +1,65 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "log/Log.h"
+#include "poller/EventPoller.h"
+#include "thread/ThreadPool.h"
+
+using namespace avc::util;
+
+/**
+ * 批量投递count个任务（每隔7个插入一个空任务），检查：
+ *      (1) 返回的句柄与tasks一一对应，空任务对应nullptr
+ *      (2) 任务按投递顺序执行
+*/
+static bool check(const std::string &name, TaskExecutor &executor, int count) {
+    std::vector<int> order;
+    std::mutex mutex;
+    TaskExecutor::TaskList tasks;
+    for (int index = 0; index < count; ++index) {
+        if (index % 7 == 3) {
+            tasks.emplace_back(nullptr);
+            continue;
+        }
+        tasks.emplace_back([&, index]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(index);
+        });
+    }
+    auto jobs = executor.asyncBatch(std::move(tasks));
+    //批量任务之后投递的同步任务，执行时批量任务都已执行
+    executor.sync([]() {});
+
+    bool ok = (int)jobs.size() == count;
+    for (int index = 0; ok && index < count; ++index) {
+        ok = (index % 7 == 3) == (jobs[index] == nullptr);
+    }
+    int expected = 0;
+    for (auto index : order) {
+        if (expected % 7 == 3) ++expected;
+        ok &= index == expected++;
+    }
+    ok &= (int)order.size() == count - (count + 3) / 7;
+
+    std::cout << name << ": tasks=" << count << " handles=" << jobs.size() << " executed=" << order.size()
+              << (ok ? " in order" : "  FAILED") << std::endl;
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+
+    int count = argc > 1 ? atoi(argv[1]) : 1000;
+
+    auto poller = EventPoller::create();
+    poller->runLoop();
+    //单线程的线程池才保证执行顺序
+    auto threadPool = ThreadPool::create(1);
+
+    bool ok = true;
+    ok &= check("EventPoller", *poller, count);
+    ok &= check("ThreadPool ", *threadPool, count);
+    return ok ? 0 : 1;
+}
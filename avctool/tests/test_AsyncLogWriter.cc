@@ -0,0 +1,202 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "log/Log.h"
+
+using namespace avc::util;
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * 只计数不输出的日志通道，用于单独测量writer的开销，并检查同一线程的日志顺序
+*/
+class LogChannelCounter : public LogChannel {
+public:
+    void writeLog(LogContext::Ptr log) override {
+        ++count_;
+        //日志行号保存的是线程序号，正文是该线程内的递增序号
+        auto thread = log->env_.line;
+        auto seq = std::stoul(log->str());
+        if (thread >= 0 && thread < (int)last_.size()) {
+            if (seq < last_[thread]) ++disorder_;
+            last_[thread] = seq;
+        }
+    }
+
+    void reset(int threads) {
+        count_ = 0;
+        disorder_ = 0;
+        last_.assign(threads, 0);
+    }
+public:
+    size_t count_ = 0;
+    size_t disorder_ = 0;
+    std::vector<unsigned long> last_;
+};//class LogChannelCounter
+
+/**
+ * 对比用：所有线程加同一把锁写入vector的异步writer
+*/
+class MutexLogWriter : public LogWriter {
+public:
+    MutexLogWriter() {
+        thread_ = std::thread([this]() { run(); });
+    }
+    ~MutexLogWriter() {
+        exit_ = true;
+        semphore_.post();
+        thread_.join();
+    }
+    void writeLog(LogContext::Ptr log, Logger &logger) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.emplace_back(std::move(log), &logger);
+        }
+        semphore_.post();
+    }
+private:
+    void run() {
+        while (true) {
+            semphore_.wait();
+            decltype(pending_) tmp;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                tmp.swap(pending_);
+            }
+            for (auto &node : tmp) {
+                node.second->writeLogToChannels(node.first);
+            }
+            if (exit_ && tmp.empty()) break;
+        }
+    }
+private:
+    std::mutex mutex_;
+    std::vector<std::pair<LogContext::Ptr, Logger *>> pending_;
+    Semphore semphore_;
+    std::atomic<bool> exit_{false};
+    std::thread thread_;
+};//class MutexLogWriter
+
+/**
+ * threads个线程同时写日志，统计每次写日志调用的延迟分布
+*/
+static void bench(const std::string &name, LogWriter::Ptr writer, int threads, int lines) {
+    Logger logger;
+    auto counter = std::make_shared<LogChannelCounter>();
+    counter->reset(threads);
+    logger.addLogChannel(counter);
+    logger.setWriter(writer);
+
+    std::vector<std::vector<uint32_t>> samples(threads);
+    std::vector<std::thread> workers;
+    std::atomic<int> ready(0);
+    auto begin = nowNs();
+    for (int index = 0; index < threads; ++index) {
+        workers.emplace_back([&, index]() {
+            auto &sample = samples[index];
+            sample.reserve(lines);
+            ready++;
+            while (ready < threads) std::this_thread::yield();
+            for (int seq = 0; seq < lines; ++seq) {
+                //日志上下文在计时之外创建，只测量写入writer的耗时
+                auto log = LogContext::create(LogLevel::kLogLevelDebug, __FILE__, __FUNCTION__, index);
+                *log << seq;
+                auto start = nowNs();
+                logger.writeLog(log);
+                sample.push_back((uint32_t)(nowNs() - start));
+            }
+        });
+    }
+    for (auto &worker : workers) worker.join();
+    auto produced = nowNs();
+    auto async = std::dynamic_pointer_cast<AsyncLogWriter>(writer);
+    uint64_t dropped = async ? async->droppedCount() : 0;
+    uint64_t spilled = async ? async->spilledCount() : 0;
+    //析构writer：写完剩余日志
+    async.reset();
+    writer.reset();
+    logger.setWriter(nullptr);
+    auto done = nowNs();
+
+    std::vector<uint32_t> all;
+    for (auto &sample : samples) all.insert(all.end(), sample.begin(), sample.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[(size_t)(p * (all.size() - 1))]; };
+    std::cout << name << ": call ns p50=" << percentile(0.5) << " p99=" << percentile(0.99)
+              << " p999=" << percentile(0.999) << " max=" << all.back()
+              << ", produce ms=" << (produced - begin) / 1000000
+              << ", total ms=" << (done - begin) / 1000000
+              << ", written=" << counter->count_ << "/" << (size_t)threads * lines
+              << ", dropped=" << dropped << ", spilled=" << spilled
+              << ", disorder=" << counter->disorder_ << std::endl;
+}
+
+/**
+ * 突发：每个线程反复写入两倍环形队列大小的日志（溢出），再以较低速率写日志，期间AsyncLogWriter线程追上
+ *      溢出在AsyncLogWriter线程取出spill后结束，之后的日志应回到无锁的环形队列，大部分日志不经过溢出队列
+*/
+static bool burst(int threads, int ringSize, int rounds) {
+    Logger logger;
+    auto counter = std::make_shared<LogChannelCounter>();
+    counter->reset(threads);
+    logger.addLogChannel(counter);
+    auto writer = std::make_shared<AsyncLogWriter>(AsyncLogWriter::kOverflowSpill, ringSize);
+    logger.setWriter(writer);
+
+    std::atomic<uint64_t> total(0);
+    std::vector<std::thread> workers;
+    for (int index = 0; index < threads; ++index) {
+        workers.emplace_back([&, index]() {
+            unsigned long seq = 0;
+            for (int round = 0; round < rounds; ++round) {
+                for (int line = 0; line < ringSize * 2; ++line) {
+                    auto log = LogContext::create(LogLevel::kLogLevelDebug, __FILE__, __FUNCTION__, index);
+                    *log << seq++;
+                    logger.writeLog(log);
+                }
+                for (int line = 0; line < ringSize * 8; ++line) {
+                    auto log = LogContext::create(LogLevel::kLogLevelDebug, __FILE__, __FUNCTION__, index);
+                    *log << seq++;
+                    logger.writeLog(log);
+                    if (line % 16 == 0) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    }
+                }
+            }
+            total += seq;
+        });
+    }
+    for (auto &worker : workers) worker.join();
+    auto spilled = writer->spilledCount();
+    writer.reset();
+    logger.setWriter(nullptr);
+
+    bool ok = counter->count_ == total && !counter->disorder_ && spilled * 2 < total;
+    std::cout << "burst       : threads=" << threads << " written=" << counter->count_ << "/" << total
+              << " spilled=" << spilled << " (" << spilled * 100 / std::max<uint64_t>(total, 1) << "%)"
+              << " disorder=" << counter->disorder_ << (ok ? "" : "  FAILED") << std::endl;
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+
+    int threads = argc > 1 ? atoi(argv[1]) : 32;
+    int lines = argc > 2 ? atoi(argv[2]) : 20000;
+    int ringSize = argc > 3 ? atoi(argv[3]) : 1024;
+
+    bench("mutex+vector", std::make_shared<MutexLogWriter>(), threads, lines);
+    bench("ring/spill  ", std::make_shared<AsyncLogWriter>(AsyncLogWriter::kOverflowSpill, ringSize), threads, lines);
+    bench("ring/block  ", std::make_shared<AsyncLogWriter>(AsyncLogWriter::kOverflowBlock, ringSize), threads, lines);
+    bench("ring/drop   ", std::make_shared<AsyncLogWriter>(AsyncLogWriter::kOverflowDrop, ringSize), threads, lines);
+    bool ok = burst(4, ringSize, 10);
+    return ok ? 0 : 1;
+}
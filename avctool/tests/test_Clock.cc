@@ -0,0 +1,89 @@
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <unistd.h>
+
+#include "util/Util.h"
+
+using namespace avc::util;
+
+/**
+ * 对比用：原先的时间戳线程，每500us更新一次原子变量
+*/
+class StampThread {
+public:
+    StampThread() {
+        thread_ = std::thread([this]() {
+            while (!exit_) {
+                stamp_.store(getMonotonicMicrosecond(), std::memory_order_release);
+                usleep(500);
+            }
+        });
+        while (!stamp_) std::this_thread::yield();
+    }
+    ~StampThread() {
+        exit_ = true;
+        thread_.join();
+    }
+    uint64_t now() const {
+        return stamp_.load(std::memory_order_acquire);
+    }
+private:
+    std::atomic<bool> exit_{false};
+    std::atomic<uint64_t> stamp_{0};
+    std::thread thread_;
+};//class StampThread
+
+static void benchCost(const char *name, int count, const std::function<uint64_t()> &func) {
+    //std::function调用本身约1~2ns，各时钟之间可以对比
+    uint64_t sum = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int index = 0; index < count; ++index) {
+        sum += func();
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << name << ": ns/call=" << (double)ns / count << " (" << sum % 10 << ")" << std::endl;
+}
+
+/**
+ * 与CLOCK_MONOTONIC对比的误差（单位微秒），在随机的时间点采样
+*/
+static void benchAccuracy(const char *name, int samples, const std::function<uint64_t()> &usec) {
+    uint64_t sum = 0, max = 0;
+    for (int index = 0; index < samples; ++index) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100 + index * 37 % 900));
+        auto value = usec();
+        auto ref = getMonotonicMicrosecond(kClockPrecise);
+        auto error = ref > value ? ref - value : value - ref;
+        sum += error;
+        if (error > max) max = error;
+    }
+    std::cout << name << ": error usec avg=" << sum / samples << " max=" << max << std::endl;
+}
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 10000000;
+    int samples = argc > 2 ? atoi(argv[2]) : 2000;
+
+    StampThread stamp;
+    benchCost("stamp thread (old)           ", count, [&]() { return stamp.now(); });
+    benchCost("getMonotonicNanosecond coarse", count, []() { return getMonotonicNanosecond(kClockCoarse); });
+    benchCost("getMonotonicNanosecond       ", count, []() { return getMonotonicNanosecond(kClockPrecise); });
+    benchCost("getCurrentMillisecond        ", count, []() { return getCurrentMillisecond(); });
+    benchCost("getCurrentMicrosecond(system)", count, []() { return getCurrentMicrosecond(true); });
+
+    benchAccuracy("stamp thread (old)           ", samples, [&]() { return stamp.now(); });
+    benchAccuracy("getMonotonicMicrosecond coarse", samples, []() { return getMonotonicMicrosecond(kClockCoarse); });
+    benchAccuracy("getCurrentMicrosecond        ", samples, []() { return getCurrentMicrosecond(); });
+
+    //程序启动时间与系统时间都单调递增（测试期间未修改系统时间）
+    auto start = getCurrentMillisecond();
+    auto startSystem = getCurrentMillisecond(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::cout << "sleep 100ms: monotonic elapsed=" << getCurrentMillisecond() - start
+              << "ms, system elapsed=" << getCurrentMillisecond(true) - startSystem << "ms" << std::endl;
+    return 0;
+}
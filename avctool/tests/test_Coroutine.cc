@@ -0,0 +1,157 @@
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "log/Log.h"
+#include "network/Socket.h"
+#include "network/SocketCoroutine.h"
+
+using namespace avc::util;
+
+/**
+ * UDP回显服务：回调方式
+*/
+static Socket::Ptr startCallbackEchoServer(const EventPoller::Ptr &poller, uint16_t port) {
+    auto sock = Socket::create(poller);
+    std::weak_ptr<Socket> weakSock = sock;
+    sock->setOnRead([weakSock](Buffer::Ptr buffer, struct sockaddr *addr, socklen_t len)->void {
+        auto strongSock = weakSock.lock();
+        if (strongSock) {
+            strongSock->send(buffer, addr, len);
+        }
+    });
+    sock->bindUdpSocket(port, "127.0.0.1");
+    return sock;
+}
+
+#if AVC_HAS_COROUTINE
+/**
+ * UDP回显服务：协程方式
+*/
+static CoTask coroutineEcho(CoSocket::Ptr sock) {
+    while (true) {
+        auto packet = co_await sock->recv();
+        if (!packet.buffer) {
+            //已关闭
+            break;
+        }
+        co_await sock->sendAll(packet.buffer, packet.addr(), packet.len);
+    }
+}
+
+static CoSocket::Ptr startCoroutineEchoServer(const EventPoller::Ptr &poller, uint16_t port) {
+    auto sock = Socket::create(poller);
+    auto coSock = CoSocket::create(sock);
+    sock->bindUdpSocket(port, "127.0.0.1");
+    poller->sync([coSock]() {
+        coroutineEcho(coSock);
+    });
+    return coSock;
+}
+#endif
+
+/**
+ * 客户端保持window个请求在途，收到回显后发送下一个，统计每秒往返次数
+*/
+static void benchEcho(const std::string &name, const EventPoller::Ptr &poller, uint16_t port, int count, int window) {
+    auto dst = SockUtil::makeSockAddr("127.0.0.1", port);
+    auto dstLen = SockUtil::get_sockaddr_len((struct sockaddr *)&dst);
+    std::string payload(64, 'x');
+
+    std::atomic<int> received(0);
+    std::atomic<int> sent(0);
+    auto client = Socket::create(poller);
+    client->setOnRead([&](Buffer::Ptr, struct sockaddr *, socklen_t)->void {
+        received++;
+        if (sent < count) {
+            sent++;
+            client->send(std::string(payload), (struct sockaddr *)&dst, dstLen);
+        }
+    });
+    client->bindUdpSocket(0, "127.0.0.1");
+
+    auto begin = std::chrono::steady_clock::now();
+    poller->sync([&]() {
+        for (int index = 0; index < window && sent < count; ++index) {
+            sent++;
+            client->send(std::string(payload), (struct sockaddr *)&dst, dstLen);
+        }
+    });
+
+    auto deadline = begin + std::chrono::seconds(10);
+    while (received < count && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    poller->sync([&]() { client->setOnRead(nullptr); });
+
+    std::cout << name << ": echoed=" << received << "/" << count
+              << ", round-trips/sec=" << (usec ? (uint64_t)received * 1000000 / usec : 0) << std::endl;
+}
+
+int main(int argc, char** argv) {
+  setThreadName("MainThread");
+  Logger::instance().addLogChannel(LogChannel::Ptr(new LogChannelConsole()));
+  Logger::instance().setWriter(LogWriter::Ptr(new AsyncLogWriter()));
+
+  int count = argc > 1 ? atoi(argv[1]) : 200000;
+  int window = argc > 2 ? atoi(argv[2]) : 32;
+
+  auto clientPoller = EventPoller::create();
+  clientPoller->runLoop();
+  auto serverPoller = EventPoller::create();
+  serverPoller->runLoop();
+
+  auto callbackServer = startCallbackEchoServer(serverPoller, 19001);
+  benchEcho("callback  echo", clientPoller, 19001, count, window);
+
+#if AVC_HAS_COROUTINE
+  auto coroutineServer = startCoroutineEchoServer(serverPoller, 19002);
+  benchEcho("coroutine echo", clientPoller, 19002, count, window);
+
+  {
+      //关闭后等待中的协程退出，释放其持有的CoSocket
+      std::weak_ptr<CoSocket> weakServer = coroutineServer;
+      serverPoller->sync([&]() { coroutineServer->close(); });
+      coroutineServer = nullptr;
+      std::cout << "coroutine echo closed: " << (weakServer.expired() ? "released" : "LEAKED") << std::endl;
+  }
+
+  {
+      //没有协程接收时，缓存数量有上限
+      auto sock = Socket::create(serverPoller);
+      auto coSock = CoSocket::create(sock);
+      coSock->setMaxCached(16);
+      sock->bindUdpSocket(19003, "127.0.0.1");
+      auto dst = SockUtil::makeSockAddr("127.0.0.1", 19003);
+      auto client = Socket::create(clientPoller);
+      client->bindUdpSocket(0, "127.0.0.1");
+      for (int index = 0; index < 100; ++index) {
+          client->send(std::string(64, 'x'), (struct sockaddr *)&dst, SockUtil::get_sockaddr_len((struct sockaddr *)&dst));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      size_t cached = 0;
+      uint64_t dropped = 0;
+      serverPoller->sync([&]() {
+          cached = coSock->cachedCount();
+          dropped = coSock->droppedCount();
+      });
+      std::cout << "cached=" << cached << " dropped=" << dropped
+                << (cached == 16 && cached + dropped == 100 ? "" : "  FAILED") << std::endl;
+  }
+
+  serverPoller->sync([]() {
+      []() -> CoTask {
+          auto begin = getCurrentMillisecond();
+          co_await sleepFor(50);
+          DebugL << "sleepFor(50) resumed after " << getCurrentMillisecond() - begin << "ms";
+      }();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+#else
+  std::cout << "coroutine echo: skipped, configure with -DAVC_ENABLE_COROUTINE=ON" << std::endl;
+#endif
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#include "log/Log.h"
+#include "poller/EventPoller.h"
+
+using namespace avc::util;
+
+/**
+ * 模拟时间下的周期定时器：每个周期到期后经过随机延迟(0 ~ period/4)才执行，每1万个周期随机卡顿0~20个周期
+ * @return 是否满足期望（kFixedRate：所有执行都在周期网格上，执行次数 + 跳过次数 = 周期数，没有漂移）
+*/
+static bool simulate(const std::string &name, DelaySchedule schedule, uint64_t period, uint64_t periods) {
+    std::mt19937_64 random(1);
+    const uint64_t start = 1000;
+    const uint64_t end = start + periods * period;
+    uint64_t deadline = start + period;
+    uint64_t now = 0, fires = 0, skipped = 0, maxBurst = 0;
+    bool onGrid = true;
+
+    while (deadline <= end) {
+        //模拟轮询线程唤醒
+        auto wakeup = deadline + random() % (period / 4 + 1);
+        if (random() % 10000 == 0) {
+            wakeup += period * (random() % 20);
+        }
+        now = std::max(now, wakeup);
+
+        //同一次唤醒中连续补执行
+        uint64_t burst = 0;
+        do {
+            ++fires;
+            ++burst;
+            if ((deadline - start) % period) {
+                onGrid = false;
+            }
+            deadline = schedule.next(deadline, now, period, skipped);
+        } while (deadline <= now && deadline <= end);
+        maxBurst = std::max(maxBurst, burst);
+    }
+
+    //最后一个周期之后的下一个到期时间，与理想值的差即为累积漂移
+    int64_t drift = (int64_t)(deadline - (start + (fires + skipped + 1) * period));
+    bool ok = schedule.mode() == DelaySchedule::kFixedDelay ||
+              (onGrid && drift == 0 && fires + skipped == periods);
+    std::cout << name << ": periods=" << periods << " fires=" << fires << " skipped=" << skipped
+              << " max burst=" << maxBurst << " on grid=" << (onGrid ? "yes" : "no")
+              << " drift=" << drift << (ok ? "" : "  FAILED") << std::endl;
+    return ok;
+}
+
+/**
+ * 真实EventPoller：周期10ms的定时器运行seconds秒，中途一个异步任务阻塞轮询线程50ms
+*/
+static void run(const std::string &name, DelaySchedule schedule, int seconds) {
+    auto poller = EventPoller::create();
+    poller->runLoop();
+
+    std::atomic<uint64_t> fires(0);
+    auto begin = getCurrentMillisecond();
+    auto task = poller->addDelayTask(10, [&]()->uint64_t {
+        fires++;
+        return 10;
+    }, 0, schedule);
+    std::this_thread::sleep_for(std::chrono::milliseconds(seconds * 500));
+    poller->async([]() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); }, false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(seconds * 500));
+    task->cancel();
+    auto elapsed = getCurrentMillisecond() - begin;
+
+    auto late = poller->getStats().timer_late_usec.snapshot();
+    std::cout << name << ": elapsed=" << elapsed << "ms fires=" << fires << " expected=" << elapsed / 10
+              << " skipped=" << poller->getStats().timers_skipped.value()
+              << " late usec p50=" << late.percentile(50) << " p99=" << late.percentile(99) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+
+    uint64_t periods = argc > 1 ? atoll(argv[1]) : 1000000;
+    int seconds = argc > 2 ? atoi(argv[2]) : 2;
+
+    bool ok = true;
+    ok &= simulate("fixed delay         ", DelaySchedule(DelaySchedule::kFixedDelay), 20, periods);
+    ok &= simulate("fixed rate burst=1  ", DelaySchedule(DelaySchedule::kFixedRate, 1), 20, periods);
+    ok &= simulate("fixed rate burst=4  ", DelaySchedule(DelaySchedule::kFixedRate, 4), 20, periods);
+    ok &= simulate("fixed rate burst=max", DelaySchedule(DelaySchedule::kFixedRate, UINT32_MAX), 20, periods);
+    //微秒单位：200us的高精度定时器
+    ok &= simulate("fixed rate 200us    ", DelaySchedule(DelaySchedule::kFixedRate, 4), 200, periods);
+
+    run("poller fixed delay", DelaySchedule(DelaySchedule::kFixedDelay), seconds);
+    run("poller fixed rate ", DelaySchedule(DelaySchedule::kFixedRate, 8), seconds);
+    return ok ? 0 : 1;
+}
@@ -1,6 +1,8 @@
 
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <functional>
 
 #include "log/Log.h"
 #include "poller/EventPoller.h"
@@ -29,6 +31,47 @@ int main(int argc, char** argv) {
       do {
           std::cin >> input;
           if (input == "post") {
+              for (int index = 0; index < 10000; ++index) {
+                  poller2->post([]() {});
+              }
+          }
+          else if (input == "slow") {
+              //超出预算的任务：第一个输出日志（包含本行的源文件与行号），其余被限频计数
+              for (int index = 0; index < 5; ++index) {
+                  poller2->async([]() { usleep(20 * 1000); });
+              }
+          }
+          else if (input == "stats") {
+              //输出轮询次数、任务排队时间、定时器延迟等统计
+              std::cout << poller2->dumpStats("poller2_");
+          }
+          else if (input == "loop") {
+              /**
+               * 轮询开销：每个任务执行时再投递下一个任务，每次轮询只执行一个任务，
+               * 同时保留一个1ms的周期定时器，统计每次轮询（唤醒、调度定时器、派发管道事件、执行任务）的平均耗时
+              */
+              static const int kLoops = 200000;
+              Semphore done;
+              int count = 0;
+              std::function<void()> step;
+              step = [&]() {
+                  if (++count < kLoops) {
+                      poller2->post([&]() { step(); }, false);
+                  }
+                  else {
+                      done.post();
+                  }
+              };
+              auto timer = poller2->addDelayTask(1, []()->uint64_t { return 1; });
+              auto loops = poller2->getStats().loops.value();
+              auto begin = std::chrono::steady_clock::now();
+              poller2->post([&]() { step(); }, false);
+              done.wait();
+              auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+              timer->cancel();
+              loops = poller2->getStats().loops.value() - loops;
+              std::cout << "tasks=" << kLoops << " loops=" << loops
+                        << " ns/task=" << ns / kLoops << " ns/loop=" << ns / (loops ? loops : 1) << std::endl;
           }
           else if (input == "send") {
           }
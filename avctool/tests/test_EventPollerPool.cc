@@ -1,17 +1,104 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
 
 #include "log/Log.h"
 #include "poller/EventPollerPool.h"
+#include "network/Socket.h"
 
 using namespace avc::util;
 
+/**
+ * 负载均衡测试：
+ *      每个会话占用一个UDP Socket（I/O事件），并注册10ms周期任务模拟处理耗时
+ *      每隔count个会话出现一个重负载会话，轮转派发时所有重负载会话都会落到同一个EventPoller上
+ *      比较轮转派发与TaskExecutorGetter派发后，各EventPoller负载的差异
+*/
+class BenchPollerGetter : public TaskExecutorGetter {
+public:
+    explicit BenchPollerGetter(int count) {
+        for (int index = 0; index < count; ++index) {
+            auto poller = EventPoller::create();
+            poller->runLoop();
+            task_executors_.push_back(poller);
+        }
+    }
+
+    EventPoller::Ptr roundRobin() {
+        return std::static_pointer_cast<EventPoller>(task_executors_[rr_pos_++ % task_executors_.size()]);
+    }
+    EventPoller::Ptr balanced() {
+        return std::static_pointer_cast<EventPoller>(getTaskExecutor());
+    }
+    const std::vector<TaskExecutor::Ptr> &executors() const {
+        return task_executors_;
+    }
+private:
+    size_t rr_pos_ = 0;
+};
+
+static void spin(int usec) {
+    auto begin = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - begin < std::chrono::microseconds(usec));
+}
+
+static void benchBalance(const std::string &name, bool balanced, int pollerCount, int sessionCount) {
+    BenchPollerGetter getter(pollerCount);
+    std::vector<Socket::Ptr> sockets;
+    std::vector<EventPoller::DelayTask::Ptr> timers;
+    std::vector<int> sessions(pollerCount, 0);
+
+    for (int index = 0; index < sessionCount; ++index) {
+        auto poller = balanced ? getter.balanced() : getter.roundRobin();
+        auto &executors = getter.executors();
+        sessions[std::find(executors.begin(), executors.end(), poller) - executors.begin()]++;
+
+        auto sock = Socket::create(poller);
+        sock->bindUdpSocket(0, "127.0.0.1");
+        sockets.push_back(sock);
+
+        int cost = (index % pollerCount == 0) ? 1500 : 50;
+        timers.push_back(poller->addDelayTask(10, [cost]()->uint64_t {
+            spin(cost);
+            return 10;
+        }));
+        //会话陆续到达，负载统计有时间反映
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    int minLoad = 100, maxLoad = 0, totalLoad = 0;
+    std::cout << name << ":";
+    for (int index = 0; index < pollerCount; ++index) {
+        int load = getter.executors()[index]->load();
+        minLoad = std::min(minLoad, load);
+        maxLoad = std::max(maxLoad, load);
+        totalLoad += load;
+        std::cout << " [sessions=" << sessions[index] << ", load=" << load << "]";
+    }
+    std::cout << std::endl << name << ": min=" << minLoad << ", max=" << maxLoad
+              << ", avg=" << totalLoad / pollerCount << std::endl;
+
+    for (auto &timer : timers) timer->cancel();
+}
+
 int main(int argc, char** argv) {
   setThreadName("MainThread");
   //使用日志库打印标准输出
   Logger::instance().addLogChannel(LogChannel::Ptr(new LogChannelConsole()));
   Logger::instance().setWriter(LogWriter::Ptr(new AsyncLogWriter()));
+
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+      int pollerCount = argc > 2 ? atoi(argv[2]) : 4;
+      int sessionCount = argc > 3 ? atoi(argv[3]) : 64;
+      benchBalance("round-robin", false, pollerCount, sessionCount);
+      benchBalance("balanced   ", true, pollerCount, sessionCount);
+      return 0;
+  }
   
   EventPollerPool::instance();
 
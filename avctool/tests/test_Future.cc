@@ -0,0 +1,133 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "log/Log.h"
+#include "poller/EventPoller.h"
+
+using namespace avc::util;
+
+/**
+ * 三级流水线：stage1 -> stage2 -> stage3，每一级运行在不同的EventPoller上
+ *      sync方式：调用线程对每一级调用sync，等待结果后再投递下一级
+ *      Future方式：asyncResult().then().then()串联，whenAll等待全部完成
+*/
+static uint64_t stage(uint64_t value) {
+    return value * 31 + 7;
+}
+
+/**
+ * 没有默认构造函数的结果类型
+*/
+struct Label {
+    explicit Label(std::string text) : text_(std::move(text)) {}
+    std::string text_;
+};
+
+static void benchSync(const std::vector<EventPoller::Ptr> &pollers, int count) {
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (int index = 0; index < count; ++index) {
+        uint64_t value = index;
+        for (auto &poller : pollers) {
+            poller->sync([&value]() { value = stage(value); });
+        }
+        sum += value;
+    }
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "sync   pipeline: count=" << count << ", sum=" << sum
+              << ", pipelines/sec=" << (usec ? (uint64_t)count * 1000000 / usec : 0) << std::endl;
+}
+
+static void benchFuture(const std::vector<EventPoller::Ptr> &pollers, int count) {
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<Future<uint64_t>> futures;
+    futures.reserve(count);
+    for (int index = 0; index < count; ++index) {
+        uint64_t value = index;
+        futures.push_back(pollers[0]->asyncResult([value]() { return stage(value); }, false)
+                                     .then(pollers[1], [](uint64_t value) { return stage(value); })
+                                     .then(pollers[2], [](uint64_t value) { return stage(value); }));
+    }
+    auto results = whenAll(std::move(futures)).get();
+    uint64_t sum = 0;
+    for (auto value : results) sum += value;
+
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "future pipeline: count=" << count << ", sum=" << sum
+              << ", pipelines/sec=" << (usec ? (uint64_t)count * 1000000 / usec : 0) << std::endl;
+}
+
+int main(int argc, char** argv) {
+  setThreadName("MainThread");
+  Logger::instance().addLogChannel(LogChannel::Ptr(new LogChannelConsole()));
+
+  int count = argc > 1 ? atoi(argv[1]) : 100000;
+
+  std::vector<EventPoller::Ptr> pollers;
+  for (int index = 0; index < 3; ++index) {
+      auto poller = EventPoller::create();
+      poller->runLoop();
+      pollers.push_back(poller);
+  }
+
+  {
+      //异常沿着then传递到最后一级
+      auto future = pollers[0]->asyncResult([]() -> int { throw std::runtime_error("stage1 failed"); })
+                               .then(pollers[1], [](int value) { return value + 1; });
+      try {
+          future.get();
+      }
+      catch (std::exception &ex) {
+          std::cout << "exception propagated: " << ex.what() << std::endl;
+      }
+  }
+
+  {
+      //Future<void>串联与whenAll
+      std::vector<Future<void>> futures;
+      for (auto &poller : pollers) {
+          futures.push_back(poller->asyncResult([]() {}).then(pollers[0], []() {}));
+      }
+      whenAll(std::move(futures)).get();
+      std::cout << "void futures completed" << std::endl;
+  }
+
+  {
+      //whenAll的多个输入同时出错：只以其中一个错误结束一次
+      bool ok = true;
+      for (int round = 0; round < 1000 && ok; ++round) {
+          std::vector<Future<int>> futures;
+          for (int index = 0; index < 9; ++index) {
+              futures.push_back(pollers[index % pollers.size()]->asyncResult([]() -> int {
+                  throw std::runtime_error("input failed");
+              }));
+          }
+          try {
+              whenAll(std::move(futures)).get();
+              ok = false;
+          }
+          catch (std::exception &) {}
+      }
+      std::cout << "whenAll with multiple errors: " << (ok ? "completed once with error" : "FAILED") << std::endl;
+  }
+
+  {
+      //结果类型不需要默认构造
+      std::vector<Future<Label>> futures;
+      for (size_t index = 0; index < pollers.size(); ++index) {
+          futures.push_back(pollers[index]->asyncResult([index]() { return Label("poller" + std::to_string(index)); }));
+      }
+      auto labels = whenAll(std::move(futures)).get();
+      std::cout << "whenAll without default constructor:";
+      for (auto &label : labels) {
+          std::cout << " " << label.text_;
+      }
+      std::cout << std::endl;
+  }
+
+  benchSync(pollers, count);
+  benchFuture(pollers, count);
+  return 0;
+}
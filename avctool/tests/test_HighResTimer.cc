@@ -0,0 +1,63 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "log/Log.h"
+#include "poller/EventPoller.h"
+
+using namespace avc::util;
+
+/**
+ * 周期定时器连续执行count次，统计相邻两次回调间隔与期望间隔的偏差（抖动），单位微秒
+ * @param highRes 是否使用addHighResDelayTask（timerfd），否则使用毫秒定时器addDelayTask
+*/
+static void bench(const EventPoller::Ptr &poller, bool highRes, uint64_t intervalUs, int count,
+                  DelaySchedule schedule = DelaySchedule()) {
+    std::vector<uint64_t> stamps;
+    stamps.reserve(count + 1);
+    Semphore done;
+    auto onDelay = [&]()->uint64_t {
+        stamps.push_back(getMonotonicNanosecond());
+        if ((int)stamps.size() > count) {
+            done.post();
+            return 0;
+        }
+        return highRes ? intervalUs : intervalUs / 1000;
+    };
+    auto task = highRes ? poller->addHighResDelayTask(intervalUs, onDelay, schedule)
+                        : poller->addDelayTask((int)(intervalUs / 1000), onDelay, 0, schedule);
+    done.wait();
+
+    std::vector<uint64_t> jitter;
+    for (size_t index = 1; index < stamps.size(); ++index) {
+        auto usec = (stamps[index] - stamps[index - 1]) / 1000;
+        jitter.push_back(usec > intervalUs ? usec - intervalUs : intervalUs - usec);
+    }
+    std::sort(jitter.begin(), jitter.end());
+    auto percentile = [&](double p) { return jitter[(size_t)(p * (jitter.size() - 1))]; };
+    std::cout << (highRes ? "timerfd" : "epoll ms")
+              << (schedule.mode() == DelaySchedule::kFixedRate ? " fixed rate" : " fixed delay")
+              << " interval=" << intervalUs << "us"
+              << ": mean interval=" << (stamps.back() - stamps.front()) / 1000.0 / count << "us"
+              << ", jitter usec p50=" << percentile(0.5) << " p99=" << percentile(0.99)
+              << " p999=" << percentile(0.999) << " max=" << jitter.back() << std::endl;
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+
+    uint64_t intervalUs = argc > 1 ? atoi(argv[1]) : 200;
+    int count = argc > 2 ? atoi(argv[2]) : 20000;
+
+    auto poller = EventPoller::create();
+    poller->runLoop();
+
+    bench(poller, true, intervalUs, count);
+    //按到期时间计算下一个周期：平均间隔没有漂移
+    bench(poller, true, intervalUs, count, DelaySchedule(DelaySchedule::kFixedRate, 4));
+    //毫秒定时器最小间隔为1ms，作为对比
+    bench(poller, false, std::max<uint64_t>(intervalUs, 1000), count / 5);
+    bench(poller, true, std::max<uint64_t>(intervalUs, 1000), count / 5);
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#include "log/Log.h"
+#include "thread/ThreadPool.h"
+#include "poller/EventPoller.h"
+
+using namespace avc::util;
+
+/**
+ * 通过替换全局operator new统计堆内存申请次数
+*/
+static std::atomic<uint64_t> s_allocCount(0);
+
+void *operator new(size_t size) {
+    s_allocCount.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+/**
+ * 投递count个任务，最后一个任务执行完成后结束统计
+ * @param usePost 使用post(InlineTask)；否则使用async(TaskIn)
+*/
+static void bench(const std::string &name, TaskExecutorInterface &executor, int count, bool usePost) {
+    //捕获64字节以内数据的任务，与典型的成员函数回调相当
+    struct Payload { void *self; uint64_t seq; uint64_t data[2]; };
+    Payload payload = { &executor, 0, { 0 } };
+    std::atomic<int> done(0);
+    Semphore sem;
+
+    auto allocBegin = s_allocCount.load();
+    auto begin = std::chrono::steady_clock::now();
+    for (int index = 0; index < count; ++index) {
+        payload.seq = index;
+        auto task = [payload, &done, &sem, count]()->void {
+            if (done.fetch_add(1) + 1 == count) sem.post();
+        };
+        if (usePost) {
+            executor.post(task, false);
+        }
+        else {
+            executor.async(task, false);
+        }
+    }
+    sem.wait();
+    auto end = std::chrono::steady_clock::now();
+    auto allocs = s_allocCount.load() - allocBegin;
+
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    std::cout << name << (usePost ? " post " : " async")
+              << ": tasks=" << count
+              << ", allocations/task=" << (double)allocs / count
+              << ", posts/sec=" << (usec ? (uint64_t)count * 1000000 / usec : 0)
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+  setThreadName("MainThread");
+
+  int count = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  {
+      InlineTask task([]() {});
+      std::cout << "InlineTask size=" << sizeof(InlineTask) << ", inline=" << task.isInline() << std::endl;
+  }
+
+  {
+      auto poller = EventPoller::create();
+      poller->runLoop();
+      //预热：任务队列扩容至稳定状态
+      bench("EventPoller", *poller, count, true);
+      bench("EventPoller", *poller, count, false);
+      bench("EventPoller", *poller, count, true);
+  }
+
+  {
+      auto threadPool = ThreadPool::create(1);
+      bench("ThreadPool ", *threadPool, count, false);
+      bench("ThreadPool ", *threadPool, count, true);
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+
+#include "log/Log.h"
+
+using namespace avc::util;
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * 统计文件行数，校验日志没有丢失
+*/
+static size_t countLines(const std::string &path) {
+    std::ifstream file(path);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(file, line)) ++count;
+    return count;
+}
+
+/**
+ * 异步写文件：统计调用点延迟分布以及持续写入速度
+ *      lines:      日志行数
+ *      maxFileSize:单个文件大小上限，较小时可以观察按大小切换文件
+*/
+static void bench(const std::string &dir, int lines, size_t maxFileSize) {
+    Logger logger;
+    auto channel = std::make_shared<LogChannelFile>(dir, "bench", maxFileSize);
+    channel->setPreallocateSize(16 * 1024 * 1024);
+    logger.addLogChannel(channel);
+    logger.setWriter(LogWriter::Ptr(new AsyncLogWriter()));
+
+    std::vector<uint32_t> samples;
+    samples.reserve(lines);
+    auto begin = nowNs();
+    for (int index = 0; index < lines; ++index) {
+        auto start = nowNs();
+        LogContextCapture(logger, LogLevel::kLogLevelDebug, __FILE__, __FUNCTION__, __LINE__)
+            << "bench message " << index << ", payload " << std::string(64, 'x');
+        samples.push_back((uint32_t)(nowNs() - start));
+    }
+    auto produced = nowNs();
+    //析构AsyncLogWriter：写完剩余日志后退出
+    logger.setWriter(nullptr);
+    auto done = nowNs();
+    auto path = channel->currentPath();
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) { return samples[(size_t)(p * (samples.size() - 1))]; };
+    std::cout << "lines=" << lines
+              << ", call ns p50=" << percentile(0.5) << " p99=" << percentile(0.99)
+              << " p999=" << percentile(0.999) << " max=" << samples.back() << std::endl;
+    std::cout << "produce lines/sec=" << (uint64_t)lines * 1000000000ULL / (produced - begin)
+              << ", sustained lines/sec=" << (uint64_t)lines * 1000000000ULL / (done - begin)
+              << ", last file=" << path << " (" << countLines(path) << " lines)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+
+    std::string dir = argc > 1 ? argv[1] : "./log";
+    int lines = argc > 2 ? atoi(argv[2]) : 200000;
+    size_t maxFileSize = argc > 3 ? (size_t)atoll(argv[3]) : 128 * 1024 * 1024;
+
+    bench(dir, lines, maxFileSize);
+    return 0;
+}
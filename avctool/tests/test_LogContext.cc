@@ -0,0 +1,279 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sstream>
+#include <sys/time.h>
+
+#include "log/Log.h"
+
+using namespace avc::util;
+
+/**
+ * 统计堆内存申请次数
+*/
+static std::atomic<uint64_t> s_allocations(0);
+
+void *operator new(size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * 只读取日志正文不输出的日志通道
+*/
+class LogChannelNull : public LogChannel {
+public:
+    void writeLog(LogContext::Ptr log) override {
+        ++lines_;
+        bytes_ += log->size();
+        last_.assign(log->data(), log->size());
+    }
+public:
+    size_t lines_ = 0;
+    size_t bytes_ = 0;
+    std::string last_;
+};//class LogChannelNull
+
+/**
+ * 丢弃输出的streambuf
+*/
+class DiscardBuf : public std::streambuf {
+protected:
+    int_type overflow(int_type ch) override {
+        setp(buf_, buf_ + sizeof(buf_));
+        return traits_type::not_eof(ch);
+    }
+private:
+    char buf_[256];
+};//class DiscardBuf
+
+/**
+ * 只格式化日志前缀与正文，不输出的日志通道，用于测量format的开销
+*/
+class LogChannelFormat : public LogChannel {
+public:
+    LogChannelFormat() : ost_(&buf_) {}
+    void writeLog(LogContext::Ptr log) override {
+        format(log, ost_);
+    }
+    const char *time(const timeval &tv) {
+        return formatTime(tv);
+    }
+private:
+    DiscardBuf buf_;
+    std::ostream ost_;
+};//class LogChannelFormat
+
+/**
+ * 只序列化不输出的JSON Lines日志通道
+*/
+class LogChannelJsonFormat : public LogChannelJson {
+public:
+    LogChannelJsonFormat() : LogChannelJson("/tmp"), ost_(&buf_) {}
+    void writeLog(LogContext::Ptr log) override {
+        format(log, ost_);
+    }
+    void formatTo(LogContext::Ptr log, std::ostream &ost) {
+        format(log, ost);
+    }
+private:
+    DiscardBuf buf_;
+    std::ostream ost_;
+};//class LogChannelJsonFormat
+
+/**
+ * 对比用：原先每行调用localtime + snprintf并返回std::string的时间格式化
+*/
+static std::string formatTimeOld(const timeval &tv) {
+    time_t sec = tv.tv_sec;
+    auto tm = localtime(&sec);
+    std::string format;
+    format.resize(128);
+    if (tm) {
+        int nwritten = snprintf((char *)format.data(), 128, "%d/%02d/%02d %02d:%02d:%02d.%03d",
+            1900 + tm->tm_year, 1 + tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, (int)(tv.tv_usec / 1000));
+        format.resize(nwritten);
+    }
+    return format;
+}
+
+/**
+ * 对比用：原先的捕获方式（ostringstream + make_shared + 拷贝线程名与正文）
+*/
+struct OldLogContext : public std::ostringstream {
+    std::string threadName;
+    std::string content;
+};
+
+template<typename FUNC>
+static void bench(const char *name, int lines, FUNC &&func) {
+    //预热：填充内存池与线程名缓存
+    for (int index = 0; index < 1000; ++index) func(index);
+
+    auto allocations = s_allocations.load();
+    auto begin = nowNs();
+    for (int index = 0; index < lines; ++index) func(index);
+    auto ns = nowNs() - begin;
+    allocations = s_allocations.load() - allocations;
+
+    std::cout << name << ": ns/line=" << (double)ns / lines
+              << ", allocations/line=" << (double)allocations / lines << std::endl;
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+    int lines = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    Logger logger;
+    auto channel = std::make_shared<LogChannelNull>();
+    logger.addLogChannel(channel);
+
+    std::string peer = "192.168.1.100";
+    bench("LogContextCapture", lines, [&](int index) {
+        LogContextCapture(logger, LogLevel::kLogLevelDebug, __FILE__, __FUNCTION__, __LINE__)
+            << "session " << index << " recv " << index * 3 << " bytes from " << peer << ":" << 8000 + index % 100;
+    });
+    std::cout << "  last line: " << channel->last_ << std::endl;
+
+    bench("PrintLog         ", lines, [&](int index) {
+        LogContextCaptureWrapper::PrintLog(logger, LogLevel::kLogLevelDebug, __FILE__, __FUNCTION__, __LINE__,
+            "session %d recv %d bytes from %s:%d", index, index * 3, peer.data(), 8000 + index % 100);
+    });
+
+    bench("ostringstream old", lines, [&](int index) {
+        auto log = std::make_shared<OldLogContext>();
+        log->threadName = getThreadName();
+        *log << "session " << index << " recv " << index * 3 << " bytes from " << peer << ":" << 8000 + index % 100;
+        log->content = log->str();
+        channel->bytes_ += log->content.size();
+    });
+
+    //运行时关闭的日志：宏只读取一次最低级别，不创建LogContext，参数也不求值
+    Logger::instance().addLogChannel(channel);
+    Logger::instance().setLevel(LogLevel::kLogLevelWarn);
+    int evaluated = 0;
+    auto sideEffect = [&]() { return ++evaluated; };
+    bench("TraceL disabled  ", lines, [&](int index) {
+        TraceL << "session " << index << " recv " << sideEffect() << " bytes from " << peer;
+    });
+    bench("PrintT disabled  ", lines, [&](int index) {
+        PrintT("session %d recv %d bytes from %s", index, sideEffect(), peer.data());
+    });
+    bench("WarnL enabled    ", lines, [&](int index) {
+        WarnL << "session " << index << " recv " << index * 3 << " bytes from " << peer;
+    });
+    std::cout << "  disabled arguments evaluated=" << evaluated << std::endl;
+
+    //异步写日志时的调用点耗时：PrintL在调用线程格式化，DeferL只编码参数，格式化在AsyncLogWriter线程完成
+    Logger::instance().setLevel(LogLevel::kLogLevelTrace);
+    Logger::instance().setWriter(std::make_shared<AsyncLogWriter>());
+    bench("PrintD async     ", lines, [&](int index) {
+        PrintD("session %d recv %d bytes from %s:%d, rtt %.3fms", index, index * 3, peer.data(), 8000 + index % 100, index / 7.0);
+    });
+    bench("DeferD async     ", lines, [&](int index) {
+        DeferD("session %d recv %d bytes from %s:%d, rtt %.3fms", index, index * 3, peer.data(), 8000 + index % 100, index / 7.0);
+    });
+    Logger::instance().setWriter(nullptr);
+    std::cout << "  last line: " << channel->last_ << std::endl;
+
+    //调用点限流与采样：被丢弃的日志只做计数
+    {
+        auto before = channel->lines_;
+        auto begin = getCurrentMillisecond();
+        bench("WarnRateL(100)   ", lines, [&](int index) {
+            WarnRateL(100) << "sendto failed: " << index;
+        });
+        auto elapsed = getCurrentMillisecond() - begin;
+        std::cout << "  written=" << channel->lines_ - before << " in " << elapsed << "ms, last: " << channel->last_ << std::endl;
+
+        before = channel->lines_;
+        bench("WarnSampleL(1000)", lines, [&](int index) {
+            WarnSampleL(1000) << "recv packet " << index;
+        });
+        std::cout << "  written=" << channel->lines_ - before << ", last: " << channel->last_ << std::endl;
+    }
+
+    //日志时间格式化：模拟每条日志间隔10us的持续写入
+    {
+        LogChannelFormat format;
+        std::vector<LogContext::Ptr> logs;
+        for (int index = 0; index < 1000; ++index) {
+            auto log = LogContext::create(LogLevel::kLogLevelDebug, __FILE__, __FUNCTION__, __LINE__);
+            *log << "session " << index << " recv " << index * 3 << " bytes";
+            logs.push_back(log);
+        }
+        timeval tv;
+        gettimeofday(&tv, nullptr);
+        auto advance = [&]() {
+            tv.tv_usec += 10;
+            if (tv.tv_usec >= 1000000) {
+                tv.tv_usec -= 1000000;
+                ++tv.tv_sec;
+            }
+        };
+        size_t bytes = 0;
+        bench("formatTime old   ", lines, [&](int) {
+            advance();
+            bytes += formatTimeOld(tv).size();
+        });
+        bench("formatTime cached", lines, [&](int) {
+            advance();
+            bytes += strlen(format.time(tv));
+        });
+        std::cout << "  old=" << formatTimeOld(tv) << ", cached=" << format.time(tv) << std::endl;
+        bench("channel format   ", lines, [&](int index) {
+            auto &log = logs[index % logs.size()];
+            advance();
+            log->env_.tv = tv;
+            format.writeLog(log);
+        });
+
+        //带结构化字段的日志：文本通道以 key=value 追加，JSON通道直接序列化
+        for (size_t index = 0; index < logs.size(); ++index) {
+            *logs[index] << LogKV("peer", "192.168.1.100") << LogKV("port", 8000 + (int)index)
+                         << LogKV("rtt", index / 7.0) << LogKV("ok", index % 2 == 0);
+        }
+        LogChannelJsonFormat json;
+        bench("text format+kv   ", lines, [&](int index) {
+            auto &log = logs[index % logs.size()];
+            advance();
+            log->env_.tv = tv;
+            format.writeLog(log);
+        });
+        bench("json format+kv   ", lines, [&](int index) {
+            auto &log = logs[index % logs.size()];
+            advance();
+            log->env_.tv = tv;
+            json.writeLog(log);
+        });
+        auto log = LogContext::create(LogLevel::kLogLevelWarn, __FILE__, __FUNCTION__, __LINE__);
+        *log << "quote \" backslash \\ tab \t ctrl \x01" << LogKV("peer", std::string("1.2.3.4")) << LogKV("errno", -111);
+        std::ostringstream line;
+        json.formatTo(log, line);
+        std::cout << "  json: " << line.str() << std::endl;
+    }
+
+    //超过内部缓冲的长日志转存到堆上，内容保持完整
+    std::string longText(1000, 'x');
+    LogContextCapture(logger, LogLevel::kLogLevelDebug, __FILE__, __FUNCTION__, __LINE__) << "long " << longText << " end";
+    std::cout << "long line size=" << channel->last_.size()
+              << (channel->last_ == "long " + longText + " end" ? " ok" : " mismatch") << std::endl;
+    return 0;
+}
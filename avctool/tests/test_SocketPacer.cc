@@ -0,0 +1,243 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "log/Log.h"
+#include "poller/EventPoller.h"
+#include "network/Socket.h"
+#include "error/uv_errno.h"
+
+using namespace avc::util;
+
+/**
+ * 进程CPU时间（用户态 + 内核态），单位微秒
+*/
+static uint64_t cpuUsec() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL
+         + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/**
+ * 接收端：统计每10ms收到的字节数
+*/
+class Receiver {
+public:
+    explicit Receiver(const EventPoller::Ptr &poller) : poller_(poller) {
+        fd_ = SockUtil::bindUdpSocket(0, "127.0.0.1");
+        SockUtil::setNoBlocked(fd_);
+        SockUtil::setRecvBuffer(fd_, 8 * 1024 * 1024);
+        port_ = SockUtil::get_local_port(fd_);
+        poller_->attachEvent(fd_, EventPoller::Event::kEventRead, [this](int) { onRead(); });
+    }
+    ~Receiver() {
+        poller_->sync([this]() { poller_->detachEvent(fd_); });
+        close(fd_);
+    }
+
+    uint16_t port() const { return port_; }
+
+    /**
+     * 开始统计，返回[begin, end)之间每10ms的字节数
+    */
+    void start() {
+        poller_->sync([this]() {
+            begin_ = getCurrentMillisecond();
+            bins_.clear();
+            packets_ = 0;
+        });
+    }
+    std::vector<uint64_t> stop(uint64_t &packets) {
+        std::vector<uint64_t> bins;
+        poller_->sync([&]() {
+            auto count = (getCurrentMillisecond() - begin_) / 10;
+            bins_.resize(count);
+            bins.swap(bins_);
+            packets = packets_;
+            begin_ = 0;
+        });
+        return bins;
+    }
+private:
+    void onRead() {
+        char buffer[2048];
+        while (true) {
+            auto n = ::recv(fd_, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            if (!begin_) continue;
+            auto bin = (getCurrentMillisecond() - begin_) / 10;
+            if (bin >= bins_.size()) bins_.resize(bin + 1);
+            bins_[bin] += n;
+            ++packets_;
+        }
+    }
+private:
+    EventPoller::Ptr poller_;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    uint64_t begin_ = 0;
+    uint64_t packets_ = 0;
+    std::vector<uint64_t> bins_;
+};//class Receiver
+
+/**
+ * 一路直播流扇出到count个UDP Socket（同一EventPoller）：每秒一个关键帧，每个Socket在同一时刻收到keyPackets个包
+ * @param mode burst:  不限速，整个关键帧直接写入内核
+ *             socket: 每个Socket限速
+ *             group:  每个Socket限速，并且共享总限速（上行带宽）
+*/
+static void bench(const std::string &mode, int count, int keyPackets, int packetSize, int seconds,
+                  Receiver &receiver) {
+    auto poller = EventPoller::create();
+    poller->runLoop();
+
+    //每个Socket的平均速率为keyPackets * packetSize字节/秒，限速留25%余量，允许2个包的突发
+    uint64_t rate = keyPackets * packetSize * 5 / 4;
+    uint64_t burst = packetSize * 2;
+    //总限速与所有Socket限速之和相同，突发为1ms的数据量
+    auto group = mode == "group" ? PacerGroup::create(rate * count, rate * count / 1000) : nullptr;
+
+    std::vector<Socket::Ptr> sockets;
+    poller->sync([&]() {
+        for (int index = 0; index < count; ++index) {
+            auto sock = Socket::create(poller);
+            if (-1 == sock->bindUdpSocket(0, "127.0.0.1")) break;
+            if (mode != "burst") {
+                sock->setPacing(rate, burst, group);
+            }
+            sockets.push_back(sock);
+        }
+    });
+
+    auto dst = SockUtil::makeSockAddr("127.0.0.1", receiver.port());
+    auto addr = (struct sockaddr *)&dst;
+    auto len = SockUtil::get_sockaddr_len(addr);
+    auto packet = BufferRaw::create(std::string(packetSize, 'x').data(), packetSize);
+    uint64_t sent = 0;
+    auto keyFrame = poller->addDelayTask(1, [&]()->uint64_t {
+        for (auto &sock : sockets) {
+            for (int index = 0; index < keyPackets; ++index) {
+                sock->send(packet, addr, len);
+            }
+        }
+        sent += sockets.size() * keyPackets;
+        return 1000;
+    }, 0, DelaySchedule(DelaySchedule::kFixedRate));
+
+    //第一个关键帧之后开始统计
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    receiver.start();
+    auto loops = poller->getStats().loops.value();
+    auto timers = poller->getStats().timers.value();
+    auto cpu = cpuUsec();
+    uint64_t sentBegin = 0, sentEnd = 0;
+    poller->sync([&]() { sentBegin = sent; });
+    auto begin = getCurrentMicrosecond();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    uint64_t received = 0;
+    auto bins = receiver.stop(received);
+    auto elapsed = getCurrentMicrosecond() - begin;
+    cpu = cpuUsec() - cpu;
+    loops = poller->getStats().loops.value() - loops;
+    timers = poller->getStats().timers.value() - timers;
+    //统计期间结束时仍在限速队列中的包计入发送，但不计入丢失
+    uint64_t queued = 0;
+    poller->sync([&]() {
+        for (auto &sock : sockets) queued += sock->getQueuedBytes();
+    });
+    poller->sync([&]() { sentEnd = sent; });
+
+    uint64_t total = 0, peak = 0;
+    for (auto bytes : bins) {
+        total += bytes;
+        peak = std::max(peak, bytes);
+    }
+    double mean = bins.empty() ? 0 : (double)total / bins.size();
+    double variance = 0;
+    for (auto bytes : bins) {
+        variance += (bytes - mean) * (bytes - mean);
+    }
+    double cv = bins.empty() || !mean ? 0 : std::sqrt(variance / bins.size()) / mean;
+    auto idle = std::count(bins.begin(), bins.end(), 0);
+    auto expected = (int64_t)(sentEnd - sentBegin) - (int64_t)(queued / packetSize);
+
+    std::cout << mode << ": sockets=" << sockets.size() << " rate=" << rate << "B/s"
+              << " throughput=" << total * 1000000 / elapsed / 1024 << "KB/s"
+              << " per 10ms: mean=" << (uint64_t)mean / 1024 << "KB peak=" << peak / 1024 << "KB"
+              << " peak/mean=" << (mean ? peak / mean : 0) << " cv=" << cv
+              << " idle bins=" << idle * 100 / std::max<size_t>(bins.size(), 1) << "%"
+              << " lost=" << std::max<int64_t>(expected - (int64_t)received, 0) * 100 / std::max<int64_t>(expected, 1) << "%"
+              << " wakeups/sec=" << loops * 1000000 / elapsed
+              << " timers/sec=" << timers * 1000000 / elapsed
+              << " cpu=" << cpu * 100 / elapsed << "%" << std::endl;
+    if (group) {
+        std::cout << "    group shaped=" << group->shapedBytes() / 1024 << "KB queued=" << group->queuedBytes() / 1024 << "KB"
+                  << std::endl;
+    }
+
+    keyFrame->cancel();
+    poller->sync([&]() { sockets.clear(); });
+}
+
+/**
+ * burstBytes为0时按1字节处理：每个包透支后等待补足，仍按速率发出全部数据，队列清空后不再唤醒
+*/
+static bool zeroBurst(Receiver &receiver) {
+    auto poller = EventPoller::create();
+    poller->runLoop();
+    auto dst = SockUtil::makeSockAddr("127.0.0.1", receiver.port());
+    auto addr = (struct sockaddr *)&dst;
+    auto len = SockUtil::get_sockaddr_len(addr);
+
+    auto sock = Socket::create(poller);
+    sock->bindUdpSocket(0, "127.0.0.1");
+    sock->setPacing(100 * 1000, 0);
+    receiver.start();
+    auto timers = poller->getStats().timers.value();
+    //20个1000字节的包，100KB/s约200ms发完
+    poller->sync([&]() {
+        for (int index = 0; index < 20; ++index) {
+            sock->send(std::string(1000, 'x'), addr, len);
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    uint64_t received = 0;
+    receiver.stop(received);
+    timers = poller->getStats().timers.value() - timers;
+    uint64_t queued = 0;
+    poller->sync([&]() {
+        queued = sock->getQueuedBytes();
+        sock = nullptr;
+    });
+
+    bool ok = received == 20 && !queued && timers <= 40;
+    std::cout << "zero burst: received=" << received << "/20 queued=" << queued << " timers=" << timers
+              << (ok ? "" : "  FAILED") << std::endl;
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+
+    int count = argc > 1 ? atoi(argv[1]) : 10000;
+    int keyPackets = argc > 2 ? atoi(argv[2]) : 4;
+    int packetSize = argc > 3 ? atoi(argv[3]) : 1000;
+    int seconds = argc > 4 ? atoi(argv[4]) : 5;
+
+    auto receiverPoller = EventPoller::create();
+    receiverPoller->runLoop();
+    Receiver receiver(receiverPoller);
+
+    bool ok = zeroBurst(receiver);
+    bench("burst", count, keyPackets, packetSize, seconds, receiver);
+    bench("socket", count, keyPackets, packetSize, seconds, receiver);
+    bench("group", count, keyPackets, packetSize, seconds, receiver);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "log/Log.h"
+#include "network/Socket.h"
+#include "network/SocketRebalancer.h"
+
+using namespace avc::util;
+
+/**
+ * 负载收敛测试：
+ *      所有会话（UDP Socket）初始都创建在第一个EventPoller上，每个数据包处理耗时固定，
+ *      发送线程以固定速率向每个会话发送数据包，SocketRebalancer周期执行迁移，
+ *      每秒打印各个EventPoller的负载，最大与最小负载的差值应逐渐收敛
+*/
+static void spin(int usec) {
+    auto begin = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - begin < std::chrono::microseconds(usec));
+}
+
+int main(int argc, char** argv) {
+  setThreadName("MainThread");
+  Logger::instance().addLogChannel(LogChannel::Ptr(new LogChannelConsole()));
+  Logger::instance().setWriter(LogWriter::Ptr(new AsyncLogWriter()));
+
+  int pollerCount = argc > 1 ? atoi(argv[1]) : 4;
+  int sessionCount = argc > 2 ? atoi(argv[2]) : 8;
+  int seconds = argc > 3 ? atoi(argv[3]) : 10;
+  int packetCost = 250;//每个数据包处理耗时(us)
+  int packetRate = 200;//每个会话每秒数据包数量
+
+  std::vector<EventPoller::Ptr> pollers;
+  for (int index = 0; index < pollerCount; ++index) {
+      auto poller = EventPoller::create();
+      poller->runLoop();
+      pollers.push_back(poller);
+  }
+
+  std::vector<Socket::Ptr> sockets;
+  std::vector<struct sockaddr_storage> addrs;
+  for (int index = 0; index < sessionCount; ++index) {
+      auto sock = Socket::create(pollers[0]);
+      sock->setOnRead([packetCost](Buffer::Ptr, struct sockaddr *, socklen_t)->void {
+          spin(packetCost);
+      });
+      uint16_t port = 19100 + index;
+      sock->bindUdpSocket(port, "127.0.0.1");
+      sockets.push_back(sock);
+      addrs.push_back(SockUtil::makeSockAddr("127.0.0.1", port));
+  }
+
+  auto rebalancer = SocketRebalancer::create(pollers, 10);
+  for (auto &sock : sockets) {
+      rebalancer->addSocket(sock);
+  }
+  auto timerPoller = EventPoller::create();
+  timerPoller->runLoop();
+  rebalancer->start(timerPoller, 1000);
+
+  std::atomic<bool> exit(false);
+  std::thread sender([&]() {
+      int fd = SockUtil::bindUdpSocket(0, "127.0.0.1");
+      std::string payload(64, 'x');
+      auto interval = std::chrono::microseconds(1000000 / packetRate);
+      auto next = std::chrono::steady_clock::now();
+      while (!exit) {
+          for (auto &addr : addrs) {
+              ::sendto(fd, payload.data(), payload.size(), 0, (struct sockaddr *)&addr,
+                       SockUtil::get_sockaddr_len((struct sockaddr *)&addr));
+          }
+          next += interval;
+          std::this_thread::sleep_until(next);
+      }
+      close(fd);
+  });
+
+  /**
+   * load: ThreadLoadCounter统计的负载
+   * busy: 该EventPoller上所有会话在这一秒内处理读事件的耗时占比
+  */
+  std::vector<uint64_t> lastBusy(sessionCount, 0);
+  for (int second = 1; second <= seconds; ++second) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+
+      std::vector<int> counts(pollerCount, 0);
+      std::vector<int> busy(pollerCount, 0);
+      for (int index = 0; index < sessionCount; ++index) {
+          auto poller = sockets[index]->getPoller();
+          auto pos = std::find(pollers.begin(), pollers.end(), poller) - pollers.begin();
+          auto total = sockets[index]->getBusyMicroseconds();
+          counts[pos]++;
+          busy[pos] += (int)((total - lastBusy[index]) / 10000);
+          lastBusy[index] = total;
+      }
+
+      std::cout << "t=" << second << "s:";
+      for (int index = 0; index < pollerCount; ++index) {
+          std::cout << " [sessions=" << counts[index] << ", load=" << pollers[index]->load() << ", busy=" << busy[index] << "]";
+      }
+      std::cout << " spread=" << *std::max_element(busy.begin(), busy.end()) - *std::min_element(busy.begin(), busy.end())
+                << std::endl;
+  }
+
+  exit = true;
+  sender.join();
+  rebalancer->stop();
+  return 0;
+}
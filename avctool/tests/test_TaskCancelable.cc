@@ -0,0 +1,132 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <time.h>
+
+#include "thread/TaskCancelable.h"
+
+using namespace avc::util;
+
+static void cancelTask(TaskCancelableImpl<uint64_t()> &task, bool) {
+    task.cancel();
+}
+
+static void cancelTask(TaskCancelableAtomic<uint64_t()> &task, bool waitCompletion) {
+    if (waitCompletion) {
+        task.cancelAndWait();
+    }
+    else {
+        task.cancel();
+    }
+}
+
+/**
+ * 取消竞争测试：执行线程循环执行任务，取消线程同时乱序取消任务
+ *      统计执行线程每次调用的耗时与取消线程每次取消的耗时
+*/
+template<class TASK>
+static void bench(const std::string &name, int count, int rounds, bool waitCompletion) {
+    std::vector<uint64_t> executed(count, 0);
+    std::vector<typename TASK::Ptr> tasks;
+    tasks.reserve(count);
+    for (int index = 0; index < count; ++index) {
+        uint64_t *counter = &executed[index];
+        tasks.push_back(TASK::create([counter]()->uint64_t {
+            return ++(*counter);
+        }));
+    }
+
+    std::vector<int> order(count);
+    for (int index = 0; index < count; ++index) order[index] = index;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+
+    std::atomic<bool> started(false);
+    uint64_t invoked = 0;
+    std::thread executor([&]() {
+        started = true;
+        for (int round = 0; round < rounds; ++round) {
+            for (auto &task : tasks) {
+                (*task)();
+                ++invoked;
+            }
+        }
+    });
+
+    while (!started) std::this_thread::yield();
+
+    /**
+     * 取消后记录执行次数，确认取消（并等待）后任务不再执行
+    */
+    std::vector<uint64_t> snapshot(count, 0);
+    auto begin = std::chrono::steady_clock::now();
+    for (auto index : order) {
+        cancelTask(*tasks[index], waitCompletion);
+        if (waitCompletion) snapshot[index] = executed[index];
+    }
+    auto cancelNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    executor.join();
+    auto totalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+
+    int violations = 0;
+    if (waitCompletion) {
+        for (int index = 0; index < count; ++index) {
+            if (executed[index] != snapshot[index]) ++violations;
+        }
+    }
+
+    std::cout << name << (waitCompletion ? " cancel+wait" : " cancel     ")
+              << ": tasks=" << count
+              << ", ns/cancel=" << cancelNs / count
+              << ", ns/invoke=" << (invoked ? totalNs / invoked : 0)
+              << ", run-after-cancel=" << violations
+              << std::endl;
+}
+
+/**
+ * 调用线程的CPU时间，单位微秒
+*/
+static uint64_t threadCpuUsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/**
+ * 取消并等待一个执行时间较长的回调：等待期间调用线程不应占用CPU
+*/
+static void waitLongCallback(int callbackMs) {
+    std::atomic<bool> running(false);
+    auto task = TaskCancelableAtomic<uint64_t()>::create([&]()->uint64_t {
+        running = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(callbackMs));
+        return 0;
+    });
+    std::thread executor([&]() { (*task)(); });
+    while (!running) std::this_thread::yield();
+
+    auto begin = std::chrono::steady_clock::now();
+    auto cpu = threadCpuUsec();
+    task->cancelAndWait();
+    cpu = threadCpuUsec() - cpu;
+    auto waitUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+    executor.join();
+
+    std::cout << "TaskCancelableAtomic cancel+wait " << callbackMs << "ms callback"
+              << ": waited=" << waitUs / 1000 << "ms, waiter cpu=" << cpu << "us" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 50;
+
+    bench<TaskCancelableImpl<uint64_t()>>("TaskCancelableImpl  ", count, rounds, false);
+    bench<TaskCancelableAtomic<uint64_t()>>("TaskCancelableAtomic", count, rounds, false);
+    bench<TaskCancelableAtomic<uint64_t()>>("TaskCancelableAtomic", count, rounds, true);
+    waitLongCallback(300);
+    return 0;
+}
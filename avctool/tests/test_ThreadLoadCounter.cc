@@ -1,5 +1,9 @@
 #include <iostream>
 #include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 #include "log/Log.h"
 #include "poller/EventPoller.h"
@@ -38,11 +42,62 @@ private:
     std::thread thread_;
 };
 
+/**
+ * 性能测试：
+ *      (1) 执行线程每次onSleep/onWakeup的开销
+ *      (2) 执行线程不停切换状态时，readers个线程并发调用load()的吞吐
+*/
+static void bench(int loops, int readers) {
+    {
+        ThreadLoadCounter counter;
+        auto begin = std::chrono::steady_clock::now();
+        for (int index = 0; index < loops; ++index) {
+            counter.onSleep();
+            counter.onWakeup();
+        }
+        auto nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "onSleep+onWakeup: loops=" << loops << ", ns/loop=" << nsec / loops << std::endl;
+    }
+
+    ThreadLoadCounter counter;
+    std::atomic<bool> exit(false);
+    std::thread writer([&]() {
+        while (!exit) {
+            counter.onSleep();
+            counter.onWakeup();
+        }
+    });
+
+    std::atomic<uint64_t> calls(0);
+    std::vector<std::thread> threads;
+    for (int index = 0; index < readers; ++index) {
+        threads.emplace_back([&]() {
+            uint64_t count = 0;
+            int load = 0;
+            while (!exit) {
+                load += counter.load();
+                count++;
+            }
+            calls += count + (load < 0 ? 1 : 0);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    exit = true;
+    writer.join();
+    for (auto &thread : threads) thread.join();
+    std::cout << "load(): readers=" << readers << ", calls/sec=" << calls << std::endl;
+}
+
 int main(int argc, char** argv) {
   setThreadName("MainThread");
   //使用日志库打印标准输出
   Logger::instance().addLogChannel(LogChannel::Ptr(new LogChannelConsole()));
   Logger::instance().setWriter(LogWriter::Ptr(new AsyncLogWriter()));
+
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+      bench(argc > 2 ? atoi(argv[2]) : 10000000, argc > 3 ? atoi(argv[3]) : 16);
+      return 0;
+  }
   
   try {
       auto poller = EventPoller::create();
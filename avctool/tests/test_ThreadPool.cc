@@ -30,6 +30,17 @@ int main(int argc, char** argv) {
           job->cancel();//or (*job) = nullptr;
 #endif
 ;      }
+      else if (input == "batch") {
+          //批量投递任务：一次加锁，一次唤醒
+          ThreadPool::TaskList tasks;
+          for (int index = 0; index < 10; ++index) {
+              tasks.emplace_back([index]() {
+                  DebugL << "asyncBatch task#" << index << " is being executed.";
+              });
+          }
+          auto jobs = threadPool->asyncBatch(std::move(tasks));
+          DebugL << "asyncBatch posted " << jobs.size() << " tasks.";
+      }
       else if (input == "send") {
           threadPool->sync([]() {
                 DebugL << "sync task is being executed.";
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <sys/resource.h>
+
+#include "log/Log.h"
+#include "poller/EventPoller.h"
+#include "timer/CoarseTimer.h"
+
+using namespace avc::util;
+
+/**
+ * 进程CPU时间（用户态 + 内核态），单位微秒
+*/
+static uint64_t cpuUsec() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL
+         + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/**
+ * 两次快照之间的直方图（max为第二次快照的值）
+*/
+static LatencyHistogram::Snapshot since(const LatencyHistogram::Snapshot &before, const LatencyHistogram::Snapshot &after) {
+    auto diff = after;
+    diff.count -= before.count;
+    diff.sum -= before.sum;
+    for (size_t index = 0; index < diff.buckets.size() && index < before.buckets.size(); ++index) {
+        diff.buckets[index] -= before.buckets[index];
+    }
+    return diff;
+}
+
+/**
+ * count个周期为intervalMs的保活定时器，首次到期时间在一个周期内均匀分布，统计seconds秒内的唤醒次数与CPU占用
+ * @param mode exact:   addDelayTask，精确到毫秒
+ *             slack:   addDelayTask，slackMs
+ *             coarse:  CoarseTimer（首次到期后重置为周期）
+*/
+static void bench(const std::string &mode, int count, int intervalMs, int slackMs, int seconds) {
+    auto poller = EventPoller::create();
+    poller->runLoop();
+
+    std::atomic<uint64_t> fired(0);
+    std::vector<EventPoller::DelayTask::Ptr> tasks;
+    std::vector<CoarseTimer::Ptr> timers;
+    std::mt19937 random(1);
+    Semphore created;
+    poller->async([&]() {
+        for (int index = 0; index < count; ++index) {
+            //首次到期时间在创建完成之后，不统计创建过程中到期的定时器
+            int phase = random() % intervalMs + 500;
+            if (mode == "coarse") {
+                //首次以随机相位到期，之后重置为固定周期
+                auto self = std::make_shared<std::weak_ptr<CoarseTimer>>();
+                auto timer = CoarseTimer::create([&fired, self, phase, intervalMs]() {
+                    fired.fetch_add(1, std::memory_order_relaxed);
+                    auto timer = self->lock();
+                    if (timer && phase != intervalMs) {
+                        timer->start(intervalMs);
+                        self->reset();
+                    }
+                }, poller);
+                *self = timer;
+                timer->start(phase);
+                timers.push_back(timer);
+            }
+            else {
+                tasks.push_back(poller->addDelayTask(phase, [&fired, intervalMs]()->uint64_t {
+                    fired.fetch_add(1, std::memory_order_relaxed);
+                    return intervalMs;
+                }, mode == "slack" ? slackMs : 0));
+            }
+        }
+        created.post();
+    });
+    created.wait();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    auto loops = poller->getStats().loops.value();
+    auto late = poller->getStats().timer_late_usec.snapshot();
+    auto begin = getCurrentMicrosecond();
+    auto cpu = cpuUsec();
+    auto firedBegin = fired.load();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    auto elapsed = getCurrentMicrosecond() - begin;
+    cpu = cpuUsec() - cpu;
+    loops = poller->getStats().loops.value() - loops;
+    late = since(late, poller->getStats().timer_late_usec.snapshot());
+
+    std::cout << mode << (mode == "slack" ? "(" + std::to_string(slackMs) + "ms)" : "")
+              << ": timers=" << count << " interval=" << intervalMs << "ms"
+              << ", wakeups/sec=" << loops * 1000000 / elapsed
+              << ", fired/sec=" << (fired.load() - firedBegin) * 1000000 / elapsed
+              << ", cpu=" << cpu * 100.0 / elapsed << "%"
+              << ", late usec p50=" << late.percentile(50) << " p99=" << late.percentile(99) << std::endl;
+
+    //同步等待清理完成，之后局部容器才能析构
+    poller->sync([&]() {
+        for (auto &task : tasks) task->cancel();
+        tasks.clear();
+        timers.clear();
+    });
+    poller = nullptr;
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    int intervalMs = argc > 2 ? atoi(argv[2]) : 5000;
+    int seconds = argc > 3 ? atoi(argv[3]) : 10;
+    int slackMs = argc > 4 ? atoi(argv[4]) : 50;
+
+    bench("exact", count, intervalMs, 0, seconds);
+    bench("slack", count, intervalMs, slackMs, seconds);
+    bench("coarse", count, intervalMs, 0, seconds);
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+
+#include "log/Log.h"
+#include "poller/EventPoller.h"
+#include "timer/Timer.h"
+#include "timer/CoarseTimer.h"
+
+using namespace avc::util;
+
+static bool check(const std::string &name, bool ok, const std::string &detail) {
+    std::cout << name << ": " << detail << (ok ? "" : "  FAILED") << std::endl;
+    return ok;
+}
+
+/**
+ * count个随机延迟(1ms ~ 10s)的单次定时器，虚拟时间推进10秒
+ *      每个定时器都应该只执行一次，且回调中now()等于其到期时间
+ * @param running 是否调用runLoop：否则定时器在调用advance的线程中执行
+*/
+static bool bench(int count, bool running) {
+    auto clock = VirtualClock::create();
+    auto poller = EventPoller::create();
+    poller->setClock(clock);
+    if (running) {
+        poller->runLoop();
+    }
+
+    std::vector<uint64_t> deadlines(count);
+    std::vector<uint32_t> fires(count, 0);
+    uint64_t wrong = 0;
+    std::mt19937 random(1);
+    auto begin = getCurrentMicrosecond();
+    poller->async([&]() {
+        for (int index = 0; index < count; ++index) {
+            int delayMs = random() % 10000 + 1;
+            deadlines[index] = poller->nowMillisecond() + delayMs;
+            poller->addDelayTask(delayMs, [&, index]()->uint64_t {
+                ++fires[index];
+                if (poller->nowMillisecond() != deadlines[index]) {
+                    ++wrong;
+                }
+                return 0;
+            });
+        }
+    });
+    //等待轮询线程添加完成（未运行时已同步添加）
+    poller->sync([]() {});
+    auto created = getCurrentMicrosecond();
+    clock->advance(10 * 1000 * 1000);
+    auto elapsed = getCurrentMicrosecond() - created;
+
+    uint64_t missed = 0;
+    for (auto fire : fires) {
+        missed += fire != 1;
+    }
+    return check(std::string("timers ") + (running ? "running poller" : "idle poller   "), !missed && !wrong,
+                 StrPrinter << "count=" << count << " virtual=10s create=" << (created - begin) / 1000 << "ms"
+                            << " advance=" << elapsed / 1000 << "ms fired=" << poller->getStats().timers.value()
+                            << " not once=" << missed << " not on deadline=" << wrong);
+}
+
+/**
+ * 周期10ms的定时器：set向前跳变1秒与advance推进1秒的执行次数
+*/
+static bool jump(const std::string &name, DelaySchedule schedule, uint64_t expectJump) {
+    auto clock = VirtualClock::create();
+    auto poller = EventPoller::create();
+    poller->setClock(clock);
+
+    uint64_t fires = 0;
+    auto task = poller->addDelayTask(10, [&]()->uint64_t {
+        ++fires;
+        return 10;
+    }, 0, schedule);
+
+    clock->advance(5 * 1000);
+    bool ok = fires == 0;
+    clock->set(clock->nowMicrosecond() + 1000 * 1000 - 5 * 1000);
+    auto jumped = fires;
+    ok &= jumped == expectJump;
+    //时间回退：不会重复执行
+    clock->set(clock->nowMicrosecond() - 500 * 1000);
+    clock->advance(400 * 1000);
+    ok &= fires == jumped;
+    //回到跳变后的时间，之后每10ms执行一次
+    clock->advance(100 * 1000);
+    auto resumed = fires;
+    clock->advance(1000 * 1000);
+    ok &= fires - resumed == 100;
+    task->cancel();
+    return check(name, ok, StrPrinter << "fires after 1s jump=" << jumped << " (expect " << expectJump << ")"
+                                      << " skipped=" << poller->getStats().timers_skipped.value()
+                                      << " fires in next 1s=" << fires - resumed);
+}
+
+/**
+ * 200us的高精度定时器（kFixedRate）、Timer与CoarseTimer在虚拟时间下的执行次数
+*/
+static bool timers() {
+    auto clock = VirtualClock::create();
+    auto poller = EventPoller::create();
+    poller->setClock(clock);
+
+    uint64_t highRes = 0, offGrid = 0;
+    auto start = poller->now();
+    auto task = poller->addHighResDelayTask(200, [&]()->uint64_t {
+        ++highRes;
+        offGrid += (poller->now() - start) % 200 != 0;
+        return 200;
+    }, DelaySchedule(DelaySchedule::kFixedRate));
+
+    uint64_t ticks = 0, coarse = 0;
+    auto timer = Timer::create([&]() { ++ticks; }, poller);
+    timer->start(100);
+    auto coarseTimer = CoarseTimer::create([&]() { ++coarse; }, poller);
+    coarseTimer->start(1000);
+
+    clock->advance(10 * 1000 * 1000);
+    task->cancel();
+    timer->stop();
+    coarseTimer->stop();
+
+    bool ok = highRes == 50000 && !offGrid && ticks == 100 && coarse == 10;
+    return check("timer types", ok, StrPrinter << "highres 200us=" << highRes << " off grid=" << offGrid
+                                             << " Timer 100ms=" << ticks << " CoarseTimer 1s=" << coarse
+                                             << " (virtual 10s)");
+}
+
+/**
+ * 同一线程中两个未运行的EventPoller（各自的虚拟时钟）交替推进，各自的CoarseTimer互不影响
+*/
+static bool coarseTimers() {
+    std::vector<VirtualClock::Ptr> clocks;
+    std::vector<EventPoller::Ptr> pollers;
+    std::vector<CoarseTimer::Ptr> timers;
+    uint64_t fires[2] = {0, 0};
+    for (int index = 0; index < 2; ++index) {
+        clocks.push_back(VirtualClock::create());
+        pollers.push_back(EventPoller::create());
+        pollers.back()->setClock(clocks.back());
+        timers.push_back(CoarseTimer::create([&fires, index]() { ++fires[index]; }, pollers.back()));
+        timers.back()->start(1000);
+    }
+    for (int second = 0; second < 10; ++second) {
+        clocks[0]->advance(1000 * 1000);
+        clocks[1]->advance(1000 * 1000);
+    }
+    for (auto &timer : timers) {
+        timer->stop();
+    }
+
+    bool ok = fires[0] == 10 && fires[1] == 10;
+    return check("coarse timers on 2 pollers", ok, StrPrinter << "fires=" << fires[0] << "/" << fires[1]
+                                                            << " (virtual 10s)");
+}
+
+int main(int argc, char **argv) {
+    setThreadName("MainThread");
+
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    bool ok = true;
+    ok &= bench(count, false);
+    ok &= bench(count / 10, true);
+    ok &= jump("fixed delay         ", DelaySchedule(DelaySchedule::kFixedDelay), 1);
+    ok &= jump("fixed rate burst=1  ", DelaySchedule(DelaySchedule::kFixedRate, 1), 1);
+    ok &= jump("fixed rate burst=max", DelaySchedule(DelaySchedule::kFixedRate, UINT32_MAX), 100);
+    ok &= timers();
+    ok &= coarseTimers();
+    return ok ? 0 : 1;
+}
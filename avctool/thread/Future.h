@@ -0,0 +1,462 @@
+#ifndef THREAD_FUTURE_H
+#define THREAD_FUTURE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "thread/InlineTask.h"
+#include "util/Semphore.h"
+
+namespace avc {
+namespace util {
+
+/**
+ * 轻量级Future/Promise
+ *
+ *  TaskExecutorInterface::sync()会阻塞调用线程，EventPoller之间互相sync时，
+ *  调用方的轮询线程被阻塞（其上的socket无法处理），甚至互相等待导致死锁。
+ *  Future通过回调串联执行：
+ *      poller1->asyncResult(fn1).then(poller2, fn2).then(poller3, fn3);
+ *  每一级结果就绪后，将下一级投递（post）到指定的执行器上执行，任何线程都不需要等待
+ *
+ *  约束：
+ *      (1) Future只能被消费一次（then/get之后失效）
+ *      (2) 上一级抛出异常时，后续的then不会执行，异常传递到最后一级
+ *      (3) Promise析构时仍未设置结果，则以std::runtime_error("broken promise")结束
+*/
+template<class T>
+class Future;
+template<class T>
+class Promise;
+struct WhenAllHelper;
+
+/**
+ * Future<void>内部使用的占位类型
+*/
+struct FutureUnit {};
+
+template<class T>
+struct FutureValue {
+    using type = T;
+};
+template<>
+struct FutureValue<void> {
+    using type = FutureUnit;
+};
+
+/**
+ * Future与Promise的共享状态
+ *      结果就绪与注册回调可能发生在不同线程，通过mutex_保护
+ *      回调在锁外执行
+*/
+template<class T>
+class FutureState {
+public:
+    using Ptr = std::shared_ptr<FutureState>;
+    using ValueType = typename FutureValue<T>::type;
+
+    FutureState() {}
+    ~FutureState() {
+        if (has_value_) {
+            value()->~ValueType();
+        }
+    }
+
+    void setValue(ValueType &&value) {
+        InlineTask callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ready_) return;
+            new (&storage_) ValueType(std::move(value));
+            has_value_ = true;
+            ready_ = true;
+            callback = std::move(callback_);
+        }
+        if (callback) callback();
+    }
+
+    void setError(std::exception_ptr error) {
+        InlineTask callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ready_) return;
+            error_ = error;
+            ready_ = true;
+            callback = std::move(callback_);
+        }
+        if (callback) callback();
+    }
+
+    /**
+     * 注册结果就绪回调，已就绪时在调用线程立即执行
+    */
+    void onReady(InlineTask &&callback) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!ready_) {
+                callback_ = std::move(callback);
+                return;
+            }
+        }
+        callback();
+    }
+
+    bool ready() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ready_;
+    }
+
+    /**
+     * 结果就绪后调用（onReady回调内部），不需要加锁
+    */
+    std::exception_ptr error() const { return error_; }
+    ValueType &&takeValue() { return std::move(*value()); }
+private:
+    ValueType *value() { return reinterpret_cast<ValueType *>(&storage_); }
+private:
+    std::mutex mutex_;
+    bool ready_ = false;
+    bool has_value_ = false;
+    typename std::aligned_storage<sizeof(ValueType), alignof(ValueType)>::type storage_;
+    std::exception_ptr error_;
+    InlineTask callback_;
+};//class FutureState
+
+/**
+ * 执行then回调，并将结果写入下一级Promise
+ *      按照输入类型（是否void）与返回类型（是否void）分别处理
+*/
+struct FutureInvoker {
+    template<class R, class T, class FUNC>
+    static void invoke(Promise<R> &promise, FutureState<T> &state, FUNC &fn) {
+        try {
+            call(promise, state, fn, std::is_void<T>(), std::is_void<R>());
+        }
+        catch (...) {
+            promise.setError(std::current_exception());
+        }
+    }
+private:
+    template<class R, class T, class FUNC>
+    static void call(Promise<R> &promise, FutureState<T> &state, FUNC &fn, std::false_type, std::false_type) {
+        promise.setValue(fn(state.takeValue()));
+    }
+    template<class R, class T, class FUNC>
+    static void call(Promise<R> &promise, FutureState<T> &state, FUNC &fn, std::false_type, std::true_type) {
+        fn(state.takeValue());
+        promise.setValue();
+    }
+    template<class R, class T, class FUNC>
+    static void call(Promise<R> &promise, FutureState<T> &, FUNC &fn, std::true_type, std::false_type) {
+        promise.setValue(fn());
+    }
+    template<class R, class T, class FUNC>
+    static void call(Promise<R> &promise, FutureState<T> &, FUNC &fn, std::true_type, std::true_type) {
+        fn();
+        promise.setValue();
+    }
+};//struct FutureInvoker
+
+/**
+ * 执行fn并将结果写入Promise，用于TaskExecutorInterface::asyncResult
+*/
+template<class R, class FUNC>
+struct PromiseTask {
+    PromiseTask(Promise<R> &&promise, FUNC &&fn) : promise_(std::move(promise)), fn_(std::move(fn)) {}
+    PromiseTask(Promise<R> &&promise, const FUNC &fn) : promise_(std::move(promise)), fn_(fn) {}
+
+    void operator()() {
+        try {
+            call(std::is_void<R>());
+        }
+        catch (...) {
+            promise_.setError(std::current_exception());
+        }
+    }
+private:
+    void call(std::false_type) { promise_.setValue(fn_()); }
+    void call(std::true_type) { fn_(); promise_.setValue(); }
+private:
+    Promise<R> promise_;
+    FUNC fn_;
+};//struct PromiseTask
+
+template<class T>
+class Promise {
+public:
+    using ValueType = typename FutureValue<T>::type;
+
+    Promise() : state_(std::make_shared<FutureState<T>>()) {}
+    Promise(Promise &&other) noexcept : state_(std::move(other.state_)) {}
+    Promise &operator=(Promise &&other) noexcept {
+        if (this != &other) {
+            abandon();
+            state_ = std::move(other.state_);
+        }
+        return *this;
+    }
+    Promise(const Promise &) = delete;
+    Promise &operator=(const Promise &) = delete;
+
+    ~Promise() {
+        abandon();
+    }
+
+    /**
+     * 获取关联的Future，仅可调用一次
+    */
+    Future<T> getFuture() {
+        return Future<T>(state_);
+    }
+
+    template<class V>
+    void setValue(V &&value) {
+        if (state_) {
+            state_->setValue(ValueType(std::forward<V>(value)));
+            state_.reset();
+        }
+    }
+
+    void setValue() {
+        if (state_) {
+            state_->setValue(ValueType());
+            state_.reset();
+        }
+    }
+
+    void setError(std::exception_ptr error) {
+        if (state_) {
+            state_->setError(error);
+            state_.reset();
+        }
+    }
+private:
+    void abandon() {
+        if (state_) {
+            setError(std::make_exception_ptr(std::runtime_error("broken promise")));
+        }
+    }
+private:
+    typename FutureState<T>::Ptr state_;
+};//class Promise
+
+template<class T>
+class Future {
+public:
+    using ValueType = typename FutureValue<T>::type;
+
+    /**
+     * then回调的返回值类型
+    */
+    template<class FUNC>
+    struct InvokeResult {
+        using type = typename std::conditional<std::is_void<T>::value,
+            std::result_of<FUNC()>,
+            std::result_of<FUNC(ValueType &&)>>::type::type;
+    };
+
+    Future() {}
+    explicit Future(typename FutureState<T>::Ptr state) : state_(std::move(state)) {}
+
+    bool valid() const {
+        return state_ != nullptr;
+    }
+
+    bool ready() const {
+        return state_ && state_->ready();
+    }
+
+    /**
+     * 结果就绪后，在executor上执行fn，返回fn结果对应的Future
+     * @param executor 执行器指针（EventPoller::Ptr、ThreadPool::Ptr等），需要提供post接口
+     * @param fn 参数为上一级结果（void时无参数），返回值作为下一级结果
+    */
+    template<class EXECUTOR, class FUNC>
+    Future<typename InvokeResult<FUNC>::type> then(const EXECUTOR &executor, FUNC &&fn) {
+        using R = typename InvokeResult<FUNC>::type;
+        Promise<R> promise;
+        auto future = promise.getFuture();
+        auto state = std::move(state_);
+        if (state) {
+            auto source = state.get();
+            source->onReady(Continuation<R, typename std::decay<FUNC>::type, EXECUTOR>(
+                std::move(state), std::move(promise), std::forward<FUNC>(fn), executor));
+        }
+        return future;
+    }
+
+    /**
+     * 阻塞等待结果
+     * @note 仅用于执行器以外的线程（例如main函数或测试代码），执行器线程中请使用then
+    */
+    ValueType get() {
+        auto state = std::move(state_);
+        if (!state) throw std::runtime_error("invalid future");
+
+        Semphore sem;
+        state->onReady([&sem]()->void { sem.post(); });
+        sem.wait();
+        if (state->error()) {
+            std::rethrow_exception(state->error());
+        }
+        return state->takeValue();
+    }
+private:
+    friend struct WhenAllHelper;
+
+    /**
+     * 上一级结果就绪时执行：将fn投递到executor
+    */
+    template<class R, class FUNC, class EXECUTOR>
+    struct Continuation {
+        Continuation(typename FutureState<T>::Ptr state, Promise<R> &&promise, FUNC &&fn, const EXECUTOR &executor)
+            : state_(std::move(state)), promise_(std::move(promise)), fn_(std::move(fn)), executor_(executor) {}
+        Continuation(typename FutureState<T>::Ptr state, Promise<R> &&promise, const FUNC &fn, const EXECUTOR &executor)
+            : state_(std::move(state)), promise_(std::move(promise)), fn_(fn), executor_(executor) {}
+
+        void operator()() {
+            if (state_->error()) {
+                promise_.setError(state_->error());
+                return;
+            }
+            auto executor = executor_;
+            executor->post(Run(std::move(state_), std::move(promise_), std::move(fn_)));
+        }
+
+        struct Run {
+            Run(typename FutureState<T>::Ptr state, Promise<R> &&promise, FUNC &&fn)
+                : state_(std::move(state)), promise_(std::move(promise)), fn_(std::move(fn)) {}
+            void operator()() {
+                FutureInvoker::invoke(promise_, *state_, fn_);
+            }
+            typename FutureState<T>::Ptr state_;
+            Promise<R> promise_;
+            FUNC fn_;
+        };//struct Run
+
+        typename FutureState<T>::Ptr state_;
+        Promise<R> promise_;
+        FUNC fn_;
+        EXECUTOR executor_;
+    };//struct Continuation
+private:
+    typename FutureState<T>::Ptr state_;
+};//class Future
+
+/**
+ * whenAll实现：第一个出错或最后一个就绪的Future所在线程负责设置结果，Promise只设置一次
+ *      结果通过unique_ptr保存，T不需要默认构造
+*/
+struct WhenAllHelper {
+    template<class T, class R>
+    struct Context {
+        Context(size_t count) : remain_(count) {}
+        std::mutex mutex_;
+        /**
+         * 未就绪的Future数量，(size_t)-1表示已经出错结束
+        */
+        size_t remain_;
+        std::vector<std::unique_ptr<T>> results_;
+        Promise<R> promise_;
+    };
+
+    template<class T, class R>
+    static void done(const std::shared_ptr<Context<T, R>> &context, std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> lock(context->mutex_);
+            if (context->remain_ == (size_t)-1) {
+                //已经以第一个错误结束，忽略之后的结果
+                return;
+            }
+            if (error) {
+                context->remain_ = (size_t)-1;
+            }
+            else if (--context->remain_ != 0) {
+                return;
+            }
+        }
+        if (error) {
+            context->promise_.setError(error);
+        }
+        else {
+            finish(context->promise_, context->results_);
+        }
+    }
+
+    template<class T>
+    static void finish(Promise<std::vector<T>> &promise, std::vector<std::unique_ptr<T>> &results) {
+        std::vector<T> values;
+        values.reserve(results.size());
+        for (auto &result : results) {
+            values.emplace_back(std::move(*result));
+        }
+        promise.setValue(std::move(values));
+    }
+    static void finish(Promise<void> &promise, std::vector<std::unique_ptr<FutureUnit>> &) {
+        promise.setValue();
+    }
+
+    template<class T, class R>
+    static Future<R> run(std::vector<Future<T>> &futures) {
+        using ValueType = typename FutureValue<T>::type;
+        auto context = std::make_shared<Context<ValueType, R>>(futures.size());
+        context->results_.resize(futures.size());
+        auto future = context->promise_.getFuture();
+        if (futures.empty()) {
+            finish(context->promise_, context->results_);
+            return future;
+        }
+
+        for (size_t index = 0; index < futures.size(); ++index) {
+            auto state = std::move(futures[index].state_);
+            if (!state) {
+                done(context, std::make_exception_ptr(std::runtime_error("invalid future")));
+                continue;
+            }
+            auto source = state.get();
+            source->onReady(Collect<T, R>(context, std::move(state), index));
+        }
+        return future;
+    }
+
+    template<class T, class R>
+    struct Collect {
+        using ValueType = typename FutureValue<T>::type;
+        Collect(std::shared_ptr<Context<ValueType, R>> context, typename FutureState<T>::Ptr state, size_t index)
+            : context_(std::move(context)), state_(std::move(state)), index_(index) {}
+        void operator()() {
+            auto error = state_->error();
+            if (!error) {
+                //不同index写入不同元素，且resize在注册回调之前完成，不需要加锁
+                context_->results_[index_].reset(new ValueType(state_->takeValue()));
+            }
+            done(context_, error);
+        }
+        std::shared_ptr<Context<ValueType, R>> context_;
+        typename FutureState<T>::Ptr state_;
+        size_t index_;
+    };
+};//struct WhenAllHelper
+
+/**
+ * 等待所有Future就绪，结果按输入顺序保存
+ *      任一Future出错则以第一个错误结束，之后就绪或出错的Future被忽略
+*/
+template<class T>
+Future<std::vector<T>> whenAll(std::vector<Future<T>> &&futures) {
+    return WhenAllHelper::run<T, std::vector<T>>(futures);
+}
+
+inline Future<void> whenAll(std::vector<Future<void>> &&futures) {
+    return WhenAllHelper::run<void, void>(futures);
+}
+
+}//namespace util
+}//namespace avc
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef THREAD_INLINETASK_H
+#define THREAD_INLINETASK_H
+
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace avc {
+namespace util {
+
+/**
+ * 仅可移动的任务类型（小对象优化）
+ *
+ *  TaskCancelableImpl每次投递需要：make_shared一次，内部strongTask_再make_shared一次，
+ *  std::function捕获较大lambda时还会再申请一次内存。
+ *
+ *  InlineTask将可调用对象直接构造在对象内部的kInlineSize字节存储中：
+ *      (1) 可调用对象大小不超过kInlineSize，且移动构造不抛异常时，不申请堆内存
+ *      (2) 超出时退化为堆上保存，行为与std::function一致
+ *  任务队列直接保存InlineTask（而不是shared_ptr），队列本身的内存可复用
+ *
+ * @note 不提供取消功能；需要取消句柄时使用TaskExecutorInterface::async
+*/
+class InlineTask {
+public:
+    static constexpr size_t kInlineSize = 64;
+
+    InlineTask() {}
+    InlineTask(std::nullptr_t) {}
+
+    template<class FUNC, class = typename std::enable_if<
+        !std::is_same<typename std::decay<FUNC>::type, InlineTask>::value>::type>
+    InlineTask(FUNC &&func) {
+        using F = typename std::decay<FUNC>::type;
+        if (isEmpty(func)) return;
+        emplace<F>(std::forward<FUNC>(func), std::integral_constant<bool, fitInline<F>()>());
+    }
+
+    InlineTask(InlineTask &&other) noexcept {
+        moveFrom(other);
+    }
+
+    InlineTask &operator=(InlineTask &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InlineTask &operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    InlineTask(const InlineTask &) = delete;
+    InlineTask &operator=(const InlineTask &) = delete;
+
+    ~InlineTask() {
+        reset();
+    }
+
+    explicit operator bool() const {
+        return ops_ != nullptr;
+    }
+
+    void operator()() {
+        ops_->invoke(storage());
+    }
+
+    void reset() {
+        if (ops_) {
+            ops_->destroy(storage());
+            ops_ = nullptr;
+        }
+    }
+
+    /**
+     * 是否存放于内部存储（未申请堆内存），用于统计
+    */
+    bool isInline() const {
+        return ops_ && ops_->inlined;
+    }
+private:
+    /**
+     * 类型擦除后的操作表，每个可调用类型对应一个静态实例
+    */
+    struct Ops {
+        void (*invoke)(void *storage);
+        void (*move)(void *dst, void *src);
+        void (*destroy)(void *storage);
+        bool inlined;
+    };
+
+    template<class F>
+    static constexpr bool fitInline() {
+        return sizeof(F) <= kInlineSize
+            && alignof(F) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible<F>::value;
+    }
+
+    template<class F>
+    struct InlineOps {
+        static void invoke(void *storage) { (*static_cast<F *>(storage))(); }
+        static void move(void *dst, void *src) {
+            new (dst) F(std::move(*static_cast<F *>(src)));
+            static_cast<F *>(src)->~F();
+        }
+        static void destroy(void *storage) { static_cast<F *>(storage)->~F(); }
+        static const Ops *ops() {
+            static const Ops s_ops = { &invoke, &move, &destroy, true };
+            return &s_ops;
+        }
+    };
+
+    template<class F>
+    struct HeapOps {
+        static F *&get(void *storage) { return *static_cast<F **>(storage); }
+        static void invoke(void *storage) { (*get(storage))(); }
+        static void move(void *dst, void *src) {
+            new (dst) F*(get(src));
+            get(src) = nullptr;
+        }
+        static void destroy(void *storage) { delete get(storage); }
+        static const Ops *ops() {
+            static const Ops s_ops = { &invoke, &move, &destroy, false };
+            return &s_ops;
+        }
+    };
+
+    template<class F, class FUNC>
+    void emplace(FUNC &&func, std::true_type) {
+        new (storage()) F(std::forward<FUNC>(func));
+        ops_ = InlineOps<F>::ops();
+    }
+
+    template<class F, class FUNC>
+    void emplace(FUNC &&func, std::false_type) {
+        new (storage()) F*(new F(std::forward<FUNC>(func)));
+        ops_ = HeapOps<F>::ops();
+    }
+
+    void moveFrom(InlineTask &other) noexcept {
+        if (other.ops_) {
+            other.ops_->move(storage(), other.storage());
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    /**
+     * 空的std::function或空函数指针，构造为空任务
+    */
+    template<class F>
+    static bool isEmpty(const F &) { return false; }
+    template<class R, class ...ARGS>
+    static bool isEmpty(const std::function<R(ARGS...)> &func) { return !func; }
+    template<class F>
+    static bool isEmpty(F *func) { return func == nullptr; }
+
+    void *storage() { return &storage_; }
+private:
+    typename std::aligned_storage<kInlineSize, alignof(std::max_align_t)>::type storage_;
+    const Ops *ops_ = nullptr;
+};//class InlineTask
+
+}//namespace util
+}//namespace avc
+
+#endif
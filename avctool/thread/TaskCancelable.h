@@ -2,6 +2,11 @@
 #define THREAD_TASKCANCELABLE_H
 
 #include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <functional>
 
 namespace avc {
 namespace util {
@@ -129,6 +134,180 @@ private:
     std::weak_ptr<FuncType> weakTask_;
 };//class TaskCancelableImpl
 
+/**
+ * 基于原子状态字的可取消任务
+ *
+ *  TaskCancelableImpl每次执行都需要weakTask_.lock()（原子CAS循环），
+ *  对于周期性重复执行的任务（例如EventPoller::DelayTask），每个周期都要付出此开销。
+ *  TaskCancelableAtomic使用一个原子状态字描述任务状态，执行与取消都是O(1)的单次CAS：
+ *      kPending   等待执行（可重复执行的任务，执行完成后回到此状态）
+ *      kRunning   正在执行（标志位，可与kCancelled同时存在）
+ *      kCancelled 已取消，不会再被执行
+ *      kDone      已完成，由执行方调用finish()设置，不会再被执行
+ *
+ *  执行中取消：cancel()仅设置kCancelled，正在进行的执行会正常结束，之后不再执行；
+ *             可调用对象由最后访问它的一方释放（未执行时由cancel释放，执行中由执行线程释放）
+ *  等待完成：wait()等待正在进行的执行结束；在任务自身的执行过程中调用wait()会直接返回
+*/
+template<class R, class ...ARGS>
+class TaskCancelableAtomic;
+
+template<class R, class ...ARGS>
+class TaskCancelableAtomic<R(ARGS...)> : public TaskCancelable {
+public:
+    using Ptr = std::shared_ptr<TaskCancelableAtomic>;
+    using FuncType = std::function<R(ARGS...)>;
+
+    enum State {
+        kPending = 0,
+        kRunning = 0x1,
+        kCancelled = 0x2,
+        kDone = 0x4,
+    };//enum State
+
+    static constexpr int kWaitSpins = 64;
+    static constexpr int kWaitMaxSleepUsec = 1000;
+
+    template<class ...CARGS>
+    static Ptr create(CARGS &&...args) {
+        return std::make_shared<TaskCancelableAtomic>(std::forward<CARGS>(args)...);
+    }
+
+    template<class FUNC>
+    explicit TaskCancelableAtomic(FUNC &&task) : func_(std::forward<FUNC>(task)) {
+        state_ = func_ ? kPending : kDone;
+    }
+
+    ~TaskCancelableAtomic() {}
+
+    /**
+     * 任务取消，可以在任意线程调用
+    */
+    void cancel() override {
+        int state = state_.load(std::memory_order_acquire);
+        while (!(state & (kCancelled | kDone))) {
+            if (state_.compare_exchange_weak(state, state | kCancelled, std::memory_order_acq_rel)) {
+                if (!(state & kRunning)) {
+                    //没有正在进行的执行，且之后不会再执行，此处释放可调用对象
+                    func_ = nullptr;
+                }
+                return;
+            }
+        }
+    }
+
+    /**
+     * 任务取消
+    */
+    void operator=(std::nullptr_t) {
+        cancel();
+    }
+
+    /**
+     * 任务取消后等待正在进行的执行结束
+    */
+    void cancelAndWait() {
+        cancel();
+        wait();
+    }
+
+    /**
+     * 等待正在进行的执行结束
+     *      先让出CPU自旋kWaitSpins次，执行仍未结束时退避为睡眠（最长kWaitMaxSleepUsec），
+     *      等待较长的回调时不占用CPU；执行方不需要额外的通知开销
+    */
+    void wait() const {
+        if (currentRunning() == this) return;
+        for (int spins = 0; state_.load(std::memory_order_acquire) & kRunning; ++spins) {
+            if (spins < kWaitSpins) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto usec = std::min(kWaitMaxSleepUsec, 1 << std::min(spins - kWaitSpins, 10));
+            std::this_thread::sleep_for(std::chrono::microseconds(usec));
+        }
+    }
+
+    /**
+     * 执行方确定任务不再重复执行时调用，释放可调用对象
+    */
+    void finish() {
+        int expected = kPending;
+        if (state_.compare_exchange_strong(expected, kDone, std::memory_order_acq_rel)) {
+            func_ = nullptr;
+        }
+    }
+
+    /**
+     * 隐式bool操作符，判断任务是否有效（未取消且未完成）
+    */
+    operator bool() const {
+        return !(state_.load(std::memory_order_acquire) & (kCancelled | kDone));
+    }
+
+    int state() const {
+        return state_.load(std::memory_order_acquire);
+    }
+
+    /**
+     *  操作符重载执行任务
+     *      任务已取消、已完成或正在执行时，返回默认值
+    */
+    R operator()(ARGS ...args) {
+        int expected = kPending;
+        if (!state_.compare_exchange_strong(expected, kRunning, std::memory_order_acq_rel)) {
+            return TaskCancelableImpl<R(ARGS...)>::template defaultValue<R>();
+        }
+        RunningGuard guard(this);
+        return func_(std::forward<ARGS>(args)...);
+    }
+private:
+    /**
+     * 记录当前线程正在执行的任务，用于wait()避免在任务内部等待自身
+    */
+    static const void *&currentRunning() {
+        static thread_local const void *s_running = nullptr;
+        return s_running;
+    }
+
+    /**
+     * 执行结束（包括抛出异常）时清除kRunning标志，执行过程中被取消则释放可调用对象
+    */
+    struct RunningGuard {
+        RunningGuard(TaskCancelableAtomic *task) : task_(task), last_(currentRunning()) {
+            currentRunning() = task;
+        }
+        ~RunningGuard() {
+            currentRunning() = last_;
+            int state = task_->state_.load(std::memory_order_acquire);
+            while (true) {
+                if (state & kCancelled) {
+                    //已取消的状态不会再改变，先释放可调用对象，再清除kRunning唤醒wait()
+                    task_->func_ = nullptr;
+                    task_->state_.fetch_and(~kRunning, std::memory_order_acq_rel);
+                    break;
+                }
+                if (task_->state_.compare_exchange_weak(state, state & ~kRunning, std::memory_order_acq_rel)) {
+                    break;
+                }
+            }
+        }
+        TaskCancelableAtomic *task_;
+        const void *last_;
+    };//struct RunningGuard
+private:
+    std::atomic<int> state_;
+    FuncType func_;
+};//class TaskCancelableAtomic
+
+/**
+ * C++11中static constexpr数据成员被ODR使用（如std::min按引用传参）时需要类外定义
+*/
+template<class R, class ...ARGS>
+constexpr int TaskCancelableAtomic<R(ARGS...)>::kWaitSpins;
+template<class R, class ...ARGS>
+constexpr int TaskCancelableAtomic<R(ARGS...)>::kWaitMaxSleepUsec;
+
 } //namespace util 
 } //namespace avc
 
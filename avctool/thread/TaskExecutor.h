@@ -2,8 +2,12 @@
 #define THREAD_TASKEXECUTOR_H
 
 #include <functional>
+#include <vector>
 
 #include "thread/TaskCancelable.h"
+#include "thread/InlineTask.h"
+#include "thread/TaskOrigin.h"
+#include "thread/Future.h"
 #include "thread/ThreadLoadCounter.h"//提供线程负载计算
 #include "util/Semphore.h"
 #include "util/OnceToken.h"
@@ -21,6 +25,7 @@ public:
     */
     using TaskIn = std::function<void()>;
     using Task = TaskCancelableImpl<void()>;
+    using TaskList = std::vector<TaskIn>;
  
     virtual ~TaskExecutorInterface() {}
 
@@ -28,19 +33,61 @@ public:
      * 异步执行任务
      * @param may_sync 如果调用async的线程与任务执行器处于同一线程，则直接执行;
      *                 否则投递到任务队列
+     * @param origin 任务投递位置，默认为调用者的源文件与行号，用于定位慢任务
     */
-    virtual Task::Ptr async(TaskIn &&task, bool may_sync = true) = 0;
+    virtual Task::Ptr async(TaskIn &&task, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) = 0;
     /**
      * 最高优先级异步执行任务 
     */
-    virtual Task::Ptr async_first(TaskIn &&task, bool may_sync = true) = 0;
+    virtual Task::Ptr async_first(TaskIn &&task, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) = 0;
+    /**
+     * 异步执行任务，不返回取消句柄
+     *      与async的区别：不创建TaskCancelableImpl，可调用对象直接保存在InlineTask内部，
+     *      捕获不超过InlineTask::kInlineSize字节时，投递过程不申请堆内存
+     *      默认实现退化为async，子类可重载为直接将InlineTask放入任务队列
+    */
+    virtual void post(InlineTask &&task, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) {
+        auto holder = std::make_shared<InlineTask>(std::move(task));
+        async([holder]()->void {
+            if (*holder) (*holder)();
+        }, may_sync, origin);
+    }
+    /**
+     * 批量异步执行任务
+     *      默认实现逐个调用async投递；子类可重载为一次加锁、一次唤醒完成投递
+     * @param tasks 按顺序执行的任务列表
+     * @param may_sync 同async，处于执行器线程时直接按顺序执行，此时返回空列表
+     * @return 返回每个任务对应的可取消句柄，顺序与tasks一致，空任务对应nullptr
+    */
+    virtual std::vector<Task::Ptr> asyncBatch(TaskList &&tasks, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) {
+        std::vector<Task::Ptr> jobs;
+        jobs.reserve(tasks.size());
+        for (auto &task : tasks) {
+            jobs.push_back(task ? async(std::move(task), may_sync, origin) : nullptr);
+        }
+        return jobs;
+    }
+    /**
+     * 异步执行任务并返回结果对应的Future
+     *      与sync的区别：调用线程不会阻塞，通过Future::then在指定执行器上继续处理结果
+     *      poller->asyncResult(fn1).then(otherPoller, fn2);
+     * @param may_sync 同async
+    */
+    template<class FUNC>
+    Future<typename std::result_of<FUNC()>::type> asyncResult(FUNC &&fn, bool may_sync = true, TaskOrigin origin = TaskOrigin::caller()) {
+        using R = typename std::result_of<FUNC()>::type;
+        Promise<R> promise;
+        auto future = promise.getFuture();
+        post(PromiseTask<R, typename std::decay<FUNC>::type>(std::move(promise), std::forward<FUNC>(fn)), may_sync, origin);
+        return future;
+    }
     /**
      * 同步执行任务
      * @param task 使用const TaskIn &类型是因为是同步任务
      * @note 同步执行任务与may_sync有所区别： may_sync表示如果处于相同线程则立马执行
      *                                      而sync等待任务执行完成（在Executor线程中执行）
     */
-    virtual void sync(const TaskIn& task) {
+    virtual void sync(const TaskIn& task, TaskOrigin origin = TaskOrigin::caller()) {
         Semphore sem;
         async([&]()->void {
             //task()函数调用可能抛出异常，因此使用RAII机制唤醒等待的调用线程
@@ -50,13 +97,13 @@ public:
 
             task();
             //sem.post();
-        });
+        }, true, origin);
         sem.wait();
     }
     /**
      * 最高优先级同步执行任务
     */
-    virtual void sync_first(const TaskIn& task) {
+    virtual void sync_first(const TaskIn& task, TaskOrigin origin = TaskOrigin::caller()) {
         Semphore sem;
         async_first([&]()->void {
             //task()函数调用可能抛出异常，因此使用RAII机制唤醒等待的调用线程
@@ -64,7 +111,7 @@ public:
                 sem.post();
             });
             task();
-        });
+        }, true, origin);
         sem.wait();
     }
 };//class TaskExecutorInterface
@@ -79,6 +126,15 @@ public:
     using Ptr = std::shared_ptr<TaskExecutor>;
 
     virtual ~TaskExecutor() {}
+
+    /**
+     * 等待执行的任务数量，用于负载均衡，需要保证可在任意线程无锁调用
+    */
+    virtual size_t pendingTaskCount() const { return 0; }
+    /**
+     * 已注册的I/O事件数量，用于负载均衡，需要保证可在任意线程无锁调用
+    */
+    virtual size_t eventCount() const { return 0; }
 };//class TaskExecutor
 
 }//namespace util
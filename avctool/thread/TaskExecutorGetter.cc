@@ -1,43 +1,47 @@
 #include "TaskExecutorGetter.h"
 
+#include <random>
+#include <thread>
+
 namespace avc {
 namespace util {
 
+/**
+ * ÿ̶߳
+*/
+static size_t randomIndex(size_t size) {
+    static thread_local std::minstd_rand s_engine(
+        (unsigned)(std::random_device()() ^ std::hash<std::thread::id>()(std::this_thread::get_id())));
+    return s_engine() % size;
+}
 
 TaskExecutor::Ptr TaskExecutorGetter::getTaskExecutor() {
+    auto size = task_executors_.size();
+    if (size == 0) return nullptr;
+    if (size == 1) return task_executors_[0];
+
     /**
-    * ض0ʱҲҪؾ
+     * һѡתѡȡض0ʱҲҪؾ
+     * ڶѡѡȡҲһظ
     */
-    if (pos_ >= task_executors_.size()) {
-        pos_ = 0;
-    }
-
-    TaskExecutor::Ptr perferred = task_executors_[pos_];
-    int minLoad = perferred->load();
-    if (minLoad == 0) {
-        //տʼʱضΪ0ɷûиevent poller
-        pos_++;
-        return perferred;
-    }
-
-    //ѯظ͵߳
-    int load = 0;
-    for (int index = 0; index < task_executors_.size(); ++index) {
-        load = task_executors_[index]->load();
-        if (load <= minLoad) {
-            minLoad = load;
-            perferred = task_executors_[index];
-            pos_ = index;
-        }
-    }
-
-    return perferred;
+    auto first = pos_.fetch_add(1, std::memory_order_relaxed) % size;
+    auto second = (first + 1 + randomIndex(size - 1)) % size;
+
+    auto &preferred = task_executors_[first];
+    auto &other = task_executors_[second];
+    return loadScore(other) < loadScore(preferred) ? other : preferred;
 }
 
 int TaskExecutorGetter::getTaskExecutorCount() const {
     return task_executors_.size();
 }
 
+int TaskExecutorGetter::loadScore(const TaskExecutor::Ptr &executor) const {
+    return executor->load() * kBusyWeight
+         + (int)executor->pendingTaskCount() * kPendingTaskWeight
+         + (int)executor->eventCount() * kEventWeight;
+}
+
 
 }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef THREAD_TASKEXECUTORGETTER_H
 #define THREAD_TASKEXECUTORGETTER_H
 
+#include <atomic>
 #include <vector>
 
 #include "thread/TaskExecutor.h"
@@ -10,15 +11,33 @@ namespace util {
 
 /**
  * 通过线程负载获取对应的TaskExecutor
+ *      负载评分综合三个指标：线程CPU使用率、等待执行的任务数量、已注册的I/O事件数量
+ *      选择方式：二选一（power of two choices），每次只比较两个候选执行器，
+ *      一个按原子计数轮转，另一个随机选取，取评分较低者；评分相同时选择轮转的候选者，
+ *      因此启动阶段负载都为0时仍然均匀派发
+ *  getTaskExecutor可在任意线程调用，task_executors_仅在子类构造时添加
 */
 class TaskExecutorGetter {
 public:
+    /**
+     * 负载评分权重
+     *      CPU使用率取值0~100，每个等待任务与每个I/O事件分别折算为对应的分数
+    */
+    static constexpr int kBusyWeight = 1;
+    static constexpr int kPendingTaskWeight = 4;
+    static constexpr int kEventWeight = 2;
+
     virtual ~TaskExecutorGetter() {}
 
     virtual TaskExecutor::Ptr getTaskExecutor();
     virtual int getTaskExecutorCount() const;
 protected:
-    size_t pos_ = 0;
+    /**
+     * 计算执行器的负载评分，值越小越空闲
+    */
+    virtual int loadScore(const TaskExecutor::Ptr &executor) const;
+protected:
+    std::atomic<size_t> pos_{0};
     std::vector<TaskExecutor::Ptr> task_executors_;
 };//class TaskExcutorGetter
 
@@ -26,4 +45,4 @@ protected:
 }
 
 
-#endif
\ No newline at end of file
+#endif
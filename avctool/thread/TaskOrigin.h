@@ -0,0 +1,38 @@
+#ifndef THREAD_TASKORIGIN_H
+#define THREAD_TASKORIGIN_H
+
+/**
+ * 获取调用者的源文件与行号
+ *      作为函数默认参数使用时，取值为调用处（而不是函数声明处）的位置，不需要调用者使用宏
+*/
+#if defined(__GNUC__) || defined(__clang__) || (defined(_MSC_VER) && _MSC_VER >= 1926)
+#define AVC_CALLER_FILE() __builtin_FILE()
+#define AVC_CALLER_LINE() __builtin_LINE()
+#else
+#define AVC_CALLER_FILE() "unknown"
+#define AVC_CALLER_LINE() 0
+#endif
+
+namespace avc {
+namespace util {
+
+/**
+ * 任务投递位置，用于定位慢任务
+ *      async(task) 等价于 async(task, true, TaskOrigin::caller())，记录调用async的位置
+*/
+struct TaskOrigin {
+    const char *file = "unknown";
+    int line = 0;
+
+    static TaskOrigin caller(const char *file = AVC_CALLER_FILE(), int line = AVC_CALLER_LINE()) {
+        TaskOrigin origin;
+        origin.file = file;
+        origin.line = line;
+        return origin;
+    }
+};//struct TaskOrigin
+
+}
+}
+
+#endif
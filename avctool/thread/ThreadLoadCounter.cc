@@ -6,9 +6,31 @@ namespace avc {
 namespace util {
 
 ThreadLoadCounter::ThreadLoadCounter(int maxCount, int maxUsec) {
-    last_wakeup_time_ = last_sleep_time_ = getCurrentMicrosecond();
-    max_size_ = maxCount;
+    max_size_ = maxCount > 0 ? maxCount : 1;
     max_usec_ = maxUsec;
+    samples_.reset(new std::atomic<uint64_t>[max_size_]);
+    for (int index = 0; index < max_size_; ++index) {
+        samples_[index].store(0, std::memory_order_relaxed);
+    }
+
+    last_time_ = getCurrentMicrosecond();
+    state_.store(pack(sleeping_, last_time_), std::memory_order_release);
+}
+
+/**
+ * 记录上一个状态的持续时间，并切换到新状态
+ *      仅由执行线程调用
+*/
+void ThreadLoadCounter::record(bool sleep, uint64_t now) {
+    if (sleeping_ != sleep) {
+        auto pos = write_pos_.load(std::memory_order_relaxed);
+        samples_[pos % max_size_].store(pack(sleeping_, now - last_time_), std::memory_order_relaxed);
+        //release保证读线程看到新的写入位置时，也能看到样本
+        write_pos_.store(pos + 1, std::memory_order_release);
+    }
+    sleeping_ = sleep;
+    last_time_ = now;
+    state_.store(pack(sleep, now), std::memory_order_release);
 }
 
 ThreadLoadCounter::~ThreadLoadCounter() {}
@@ -33,20 +55,14 @@ void ThreadLoadCounter::onSleep() {
      * */       
     time_records_.push_back(TimeRecord(TimeRecord::kSleepBegin, now));
     #else 
-        auto current = getCurrentMicrosecond();
-
-        LOCK_GUARD(mutex_);
-        if (!sleeping_) {
-            //唤醒结束，计算本次执行时间
-            time_records_.push_back(TimeRecord(sleeping_, current - last_wakeup_time_));
-            if (time_records_.size() > max_size_) {
-                time_records_.pop_front();
-            }
-        }
-        sleeping_ = true;
-        last_sleep_time_ = current;
+        //唤醒结束，记录本次执行时间
+        onSleep(getCurrentMicrosecond());
     #endif
 }
+
+void ThreadLoadCounter::onSleep(uint64_t now) {
+    record(true, now);
+}
 /**
  * 在线程执行例程中，唤醒后调用
 */
@@ -69,19 +85,14 @@ void ThreadLoadCounter::onWakeup() {
     */
     time_records_.push_back(TimeRecord(TimeRecord::kWakeupBegin, now));
     #else
-    auto current = getCurrentMicrosecond();
-    LOCK_GUARD(mutex_);
-    if (sleeping_) {
-        //睡眠结束, 记录上次本次休眠时间
-        time_records_.push_back(TimeRecord(sleeping_, current - last_sleep_time_));
-        if (time_records_.size() > max_size_) {
-            time_records_.pop_front();
-        }
-    }
-    sleeping_ = false;
-    last_wakeup_time_ = current;
+    //睡眠结束, 记录本次休眠时间
+    onWakeup(getCurrentMicrosecond());
     #endif
 }
+
+void ThreadLoadCounter::onWakeup(uint64_t now) {
+    record(false, now);
+}
  
 /**
  * 返回线程的负载，即CPU使用率
@@ -90,53 +101,50 @@ int ThreadLoadCounter::load() {
     uint64_t totalRuntime = 0;
     uint64_t totalSleepTime = 0;
 
-    auto current = getCurrentMicrosecond();
-    LOCK_GUARD(mutex_);
-    /**
-     * 统计样本中的所有运行时间与休眠时间
-     *      统计样本时间时，使用使用最近的事件计算
-    */
-
     /**
-     * load函数调用时，当前时刻产生的时间
-     *      sleeping_，用于判断当前执行线程处于唤醒还是休眠状态
+     * load函数调用时，当前状态已持续的时间
+     *      state_最高位，用于判断当前执行线程处于唤醒还是休眠状态
     */
-    if (sleeping_) {
-        totalSleepTime += current - last_wakeup_time_;
+    auto current = getCurrentMicrosecond();
+    auto state = state_.load(std::memory_order_acquire);
+    auto since = state & ~kSleepBit;
+    auto elapsed = current > since ? current - since : 0;
+    if (state & kSleepBit) {
+        totalSleepTime += elapsed;
     } 
     else {
-        totalRuntime += current - last_sleep_time_;
+        totalRuntime += elapsed;
     }
 
     /**
-     * 统计所有已存在的样本时间
+     * 由新到旧统计样本时间，超过统计窗口后停止
+     *      最后一个样本只统计窗口内的部分
+     *      读取过程中执行线程可能覆盖最旧的样本，负载统计允许这种误差
     */
-    for (auto it = time_records_.rbegin(); it != time_records_.rend(); ++it) {
-        if (it->sleep_) {
-            totalSleepTime += it->time_;
-        } 
-        else {
-            totalRuntime += it->time_;
+    auto pos = write_pos_.load(std::memory_order_acquire);
+    auto count = pos < (uint64_t)max_size_ ? pos : (uint64_t)max_size_;
+    uint64_t window = max_usec_;
+    for (uint64_t index = 0; index < count; ++index) {
+        auto totalTime = totalRuntime + totalSleepTime;
+        if (totalTime >= window) {
+            break;
         }
-    }
 
-    /**
-     * 统计样本时间，超过统计窗口
-     *      则移除最早的统计时间
-    */
-    auto totalTime = totalRuntime + totalSleepTime;
-    while ((totalTime > max_usec_) && (time_records_.size() > 0)) {
-        const auto &node = time_records_.front();
-        totalTime -= node.time_;
-        if (node.sleep_) {
-            totalSleepTime -= node.time_;
+        auto sample = samples_[(pos - 1 - index) % max_size_].load(std::memory_order_relaxed);
+        auto time = sample & ~kSleepBit;
+        if (time > window - totalTime) {
+            time = window - totalTime;
         }
+
+        if (sample & kSleepBit) {
+            totalSleepTime += time;
+        } 
         else {
-            totalRuntime -= node.time_;
+            totalRuntime += time;
         }
-        time_records_.pop_front();
     }
 
+    auto totalTime = totalRuntime + totalSleepTime;
     if (totalTime == 0) {
         return 0;
     } 
@@ -1,8 +1,9 @@
 #ifndef THREAD_THREADLOADCOUNTER_H
 #define THREAD_THREADLOADCOUNTER_H
 
-#include <list>
-#include "util/MutexWrapper.h"
+#include <atomic>
+#include <memory>
+#include <stdint.h>
 
 namespace avc {
 namespace util {
@@ -20,12 +21,14 @@ namespace util {
  *  上述方案不利于计算负载，修正后的方案：
  *      统计cpu执行情况：休眠时间与运行时间的样本数量
  *      CPU使用率: 计算一段时间内，运行时间所占比例
+ *
+ *  样本保存在固定大小的环形缓冲中，执行线程单独写入，其他线程无锁读取
  *      
 */
 class ThreadLoadCounter {
 public:
     /**
-     * @param maxCount 限制记录时间节点的数量(即list的最大数量)
+     * @param maxCount 限制记录时间样本的数量(即环形缓冲的大小)
      * @param maxUsec  统计cpu负载时的窗口大小，例如2s这个时间内，cpu使用情况
     */
     explicit ThreadLoadCounter(int maxCount = 32, int maxUsec = 2 * 1000 * 1000);
@@ -39,49 +42,47 @@ public:
      * 在线程执行例程中，唤醒后调用
     */
     void onWakeup();
+    /**
+     * 调用者已读取过当前时间时使用，避免重复读取时钟
+     * @param now 当前时间，单位微秒，与getCurrentMicrosecond为同一时钟
+    */
+    void onSleep(uint64_t now);
+    void onWakeup(uint64_t now);
     /**
      * 返回线程的负载，即CPU使用率
+     *      可在任意线程调用，不加锁，不修改样本
     */
     int load();
 private:
     /**
-     * onSleep与onWakeup有执行线程调用，用于记录线程执行时间情况
-     *      load()调用时，会出现竞争条件，所以需要加锁
-     *      在没有load调用情况下，没有竞争条件
+     * 记录一个样本，并切换线程状态
     */
-    MutexWrapper<std::mutex> mutex_;
-    bool sleeping_ =  true;
-    uint64_t last_sleep_time_;
-    uint64_t last_wakeup_time_;
-
-    struct TimeRecord {
-        #if 0
-        enum {
-            kWakeupBegin,
-            kWakeupEnd,
-            kSleepBegin,
-            kSleepEnd
-        };
-
-        TimeRecord(int state, uint64_t time) : state_(state), time_(time) {
+    void record(bool sleep, uint64_t now);
 
-        }
-        
+    /**
+     * 样本与当前状态都打包成一个uint64_t，保证其他线程读取时不会读到撕裂的值
+     *      最高位：是否为休眠时间（或当前是否处于休眠）
+     *      低63位：样本时长（或当前状态开始时间），单位微秒
+    */
+    static constexpr uint64_t kSleepBit = 1ULL << 63;
 
-        int state_;
-        #else
-        TimeRecord(bool sleep, uint64_t time) : sleep_(sleep), time_(time) {}
-        bool sleep_;//用于判断是休眠时间还是执行时间
-        #endif
-        uint64_t time_;
-    };//struct TimeRecord
+    static uint64_t pack(bool sleep, uint64_t value) {
+        return (sleep ? kSleepBit : 0) | (value & ~kSleepBit);
+    }
+private:
     /**
-     * 根据线程状态，以此记录各个时间节点
-     *      （1）list长度应该如何限制? 
-     *              list记录执行时间与休眠时间，因此使用max_size_控制最大数量即可
+     * onSleep与onWakeup仅由执行线程调用（单写者），load()由其他线程调用（多读者）
+     *      执行线程写入环形缓冲后，release方式更新写入位置；
+     *      读线程acquire方式读取写入位置后，由新到旧遍历样本
+     *      不需要加锁，热路径上也不需要申请内存
     */
-    std::list<TimeRecord> time_records_;
-    int max_size_;//避免list数量过大
+    bool sleeping_ = true;
+    uint64_t last_time_;
+    std::atomic<uint64_t> state_;//当前状态(kSleepBit)与状态开始时间
+
+    std::unique_ptr<std::atomic<uint64_t>[]> samples_;//样本环形缓冲
+    std::atomic<uint64_t> write_pos_{0};//已写入的样本总数
+    int max_size_;//环形缓冲大小
     int max_usec_;//计算cpu负载的时间窗口
 };//class ThreadLoadCounter
 
@@ -6,7 +6,7 @@
 #include <thread>
 #include <functional>
 #include <chrono>
-#include <list>
+#include <deque>
 
 #include "util/Util.h"
 #include "thread/TaskExecutor.h"
@@ -66,7 +66,7 @@ public:
         }
     }
 
-    Task::Ptr async(TaskIn&& task, bool may_sync = true) override {
+    Task::Ptr async(TaskIn&& task, bool may_sync = true, TaskOrigin /*origin*/ = TaskOrigin::caller()) override {
         if (may_sync && currentThread()) {
           if (task) task();
           return nullptr;
@@ -75,13 +75,13 @@ public:
         Task::Ptr job = Task::create(std::move(task));
         {
             LOCK_GUARD(mutex_);
-            pedding_.push_back(job);
+            pedding_.emplace_back([job]()->void { (*job)(); });
         }
         sem_.post();
         return job;
     }
     
-    Task::Ptr async_first(TaskIn&& task, bool may_sync = true) override {
+    Task::Ptr async_first(TaskIn&& task, bool may_sync = true, TaskOrigin /*origin*/ = TaskOrigin::caller()) override {
         if (may_sync && currentThread()) {
             if (task) task();
             return nullptr;
@@ -90,11 +90,60 @@ public:
         Task::Ptr job = Task::create(std::move(task));
         {
             LOCK_GUARD(mutex_);
-            pedding_.push_front(job);
+            pedding_.emplace_front([job]()->void { (*job)(); });
         }
         sem_.post();
         return job;
     }
+
+    /**
+     * 批量投递：一次加锁入队，一次信号量post唤醒
+    */
+    std::vector<Task::Ptr> asyncBatch(TaskList&& tasks, bool may_sync = true, TaskOrigin /*origin*/ = TaskOrigin::caller()) override {
+        std::vector<Task::Ptr> jobs;
+        if (may_sync && currentThread()) {
+            for (auto& task : tasks) {
+                if (task) task();
+            }
+            return jobs;
+        }
+
+        //空任务对应nullptr，句柄与tasks一一对应
+        jobs.reserve(tasks.size());
+        size_t count = 0;
+        for (auto& task : tasks) {
+            jobs.push_back(task ? Task::create(std::move(task)) : nullptr);
+            count += jobs.back() ? 1 : 0;
+        }
+        if (!count) return jobs;
+
+        {
+            LOCK_GUARD(mutex_);
+            for (auto& job : jobs) {
+                if (job) pedding_.emplace_back([job]()->void { (*job)(); });
+            }
+        }
+        sem_.post((unsigned)count);
+        return jobs;
+    }
+
+    /**
+     * 不返回取消句柄的异步任务，InlineTask直接放入任务队列
+    */
+    void post(InlineTask&& task, bool may_sync = true, TaskOrigin /*origin*/ = TaskOrigin::caller()) override {
+        if (!task) return;
+
+        if (may_sync && currentThread()) {
+            task();
+            return;
+        }
+
+        {
+            LOCK_GUARD(mutex_);
+            pedding_.emplace_back(std::move(task));
+        }
+        sem_.post();
+    }
 private:
     void shutdown() {
         exit_ = true;
@@ -122,11 +171,11 @@ private:
             sem_.wait();
             //onWakeup();
 
-            Task::Ptr job;
+            InlineTask job;
             {
                 LOCK_GUARD(mutex_);
                 if (!pedding_.empty()) {
-                    job = pedding_.front();
+                    job = std::move(pedding_.front());
                     pedding_.pop_front();
                 }
             }
@@ -134,8 +183,8 @@ private:
             //为了测试任务取消，这里延迟执行任务，以便取消任务（cancel接口先执行）  
             std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 #endif
-            if (job && (*job)) {
-                (*job)();
+            if (job) {
+                job();
             }
         }
     }
@@ -156,7 +205,10 @@ private:
     Semphore sem_;
     //std::mutex mutex_;
     MutexWrapper<std::mutex> mutex_;
-    std::list<Task::Ptr> pedding_;
+    /**
+     * 任务队列直接保存InlineTask，async投递的任务以捕获Task::Ptr的形式保存
+    */
+    std::deque<InlineTask> pedding_;
 
     std::vector<std::thread> threads_;
     OnCallback onStart_;    
@@ -0,0 +1,206 @@
+#include "CoarseTimer.h"
+
+#include <vector>
+
+#include "log/Log.h"
+
+namespace avc {
+namespace util {
+
+struct CoarseTimer::Node {
+    explicit Node(OnTimer &&onTimer) : on_timer_(std::move(onTimer)) {}
+
+    OnTimer on_timer_;
+    uint64_t period_ms_ = 0;
+    /**
+     * 到期刻度（程序启动时间 / COARSE_TIMER_RESOLUTION_MS），0表示未启动
+    */
+    uint64_t deadline_ = 0;
+    /**
+     * 每次启动、重置、停止时递增，时间轮中代数不一致的记录已失效，到达时直接丢弃
+    */
+    uint32_t generation_ = 0;
+};//struct CoarseTimer::Node
+
+/**
+ * 时间轮：每个EventPoller一个，保存在EventPoller中，只在轮询线程中访问，不需要加锁
+ *      定时器按到期刻度放入对应的槽，重置与停止只修改Node的代数，失效记录在槽到期时丢弃
+*/
+class CoarseTimerWheel {
+public:
+    using NodePtr = std::shared_ptr<CoarseTimer::Node>;
+    using Ptr = std::shared_ptr<CoarseTimerWheel>;
+
+    explicit CoarseTimerWheel(EventPoller *poller)
+        : poller_(poller), slots_(COARSE_TIMER_WHEEL_SLOTS) {
+        current_tick_ = nowTick();
+    }
+    ~CoarseTimerWheel() {
+        if (tick_task_) {
+            tick_task_->cancel();
+        }
+    }
+
+    /**
+     * 获取poller的时间轮，不存在时创建；需要在poller的轮询线程中调用
+    */
+    static const Ptr &instance(EventPoller *poller) {
+        auto &wheel = poller->coarse_timer_wheel_;
+        if (!wheel) {
+            wheel = std::make_shared<CoarseTimerWheel>(poller);
+        }
+        return wheel;
+    }
+
+    void start(const NodePtr &node, uint64_t periodMs) {
+        auto deadline = deadlineTick(periodMs);
+        if (node->deadline_ == deadline && node->period_ms_ == periodMs) {
+            //同一刻度内重复重置，时间轮中的记录仍然有效
+            return;
+        }
+        if (!node->deadline_) {
+            ++live_;
+        }
+        node->period_ms_ = periodMs;
+        insert(node, deadline);
+
+        if (!tick_task_) {
+            startTick();
+        }
+    }
+
+    void stop(const NodePtr &node) {
+        if (!node->deadline_) return;
+        node->deadline_ = 0;
+        ++node->generation_;
+        --live_;
+    }
+private:
+    struct Entry {
+        NodePtr node_;
+        uint32_t generation_;
+    };//struct Entry
+
+    uint64_t nowTick() const {
+        return poller_->nowMillisecond() / COARSE_TIMER_RESOLUTION_MS;
+    }
+
+    /**
+     * 到期刻度向上取整，保证不会提前回调
+    */
+    uint64_t deadlineTick(uint64_t periodMs) const {
+        return (poller_->nowMillisecond() + periodMs + COARSE_TIMER_RESOLUTION_MS - 1) / COARSE_TIMER_RESOLUTION_MS;
+    }
+
+    void insert(const NodePtr &node, uint64_t deadline) {
+        node->deadline_ = deadline;
+        ++node->generation_;
+        slots_[deadline % slots_.size()].push_back(Entry{node, node->generation_});
+    }
+
+    /**
+     * 时间轮的刻度通过一个周期DelayTask驱动，slack与刻度相同，
+     * 与其他相同slack的定时器在同一次唤醒中执行
+    */
+    void startTick() {
+        current_tick_ = nowTick();
+        std::weak_ptr<CoarseTimerWheel> weakSelf = instance(poller_);
+        tick_task_ = poller_->addDelayTask(COARSE_TIMER_RESOLUTION_MS, [weakSelf]()->uint64_t {
+            auto wheel = weakSelf.lock();
+            return wheel ? wheel->onTick() : 0;
+        }, COARSE_TIMER_RESOLUTION_MS);
+    }
+
+    uint64_t onTick() {
+        auto now = nowTick();
+        //处理(current_tick_, now]之间的刻度，超过一圈时每个槽只处理一次
+        auto tick = current_tick_ + 1;
+        if (now > current_tick_ + slots_.size()) {
+            tick = now - slots_.size() + 1;
+        }
+        for (; tick <= now; ++tick) {
+            expire(tick % slots_.size(), now);
+        }
+        current_tick_ = now;
+
+        if (!live_) {
+            /**
+             * 没有定时器时停止刻度，不再唤醒轮询线程
+             *      槽中只剩已停止定时器的失效记录，一并释放，避免时间轮（EventPoller）一直持有其回调
+            */
+            for (auto &slot : slots_) {
+                slot.clear();
+            }
+            tick_task_ = nullptr;
+            return 0;
+        }
+        //下一个刻度的开始时间，唤醒较晚时不会跳过刻度
+        return COARSE_TIMER_RESOLUTION_MS - poller_->nowMillisecond() % COARSE_TIMER_RESOLUTION_MS;
+    }
+
+    void expire(size_t slot, uint64_t now) {
+        /**
+         * 交换出槽中的记录后遍历，回调中启动、重置定时器时可以直接插入任意槽
+         *      firing_与槽交换后clear，稳定运行后不再申请内存
+        */
+        firing_.swap(slots_[slot]);
+        for (auto &entry : firing_) {
+            auto &node = entry.node_;
+            if (node->generation_ != entry.generation_) {
+                //已重置或停止
+                continue;
+            }
+            if (node->deadline_ > now) {
+                //超过一圈的定时器，等待之后的圈数
+                slots_[slot].push_back(std::move(entry));
+                continue;
+            }
+            //先按周期重新加入时间轮，回调中可以重置或停止
+            insert(node, deadlineTick(node->period_ms_));
+            try {
+                if (node->on_timer_) {
+                    node->on_timer_();
+                }
+            }
+            catch (...) {
+                WarnL << "coarse timer callback failed";
+            }
+        }
+        firing_.clear();
+    }
+private:
+    EventPoller *poller_;
+    std::vector<std::vector<Entry>> slots_;
+    std::vector<Entry> firing_;
+    uint64_t current_tick_ = 0;//已处理到的刻度
+    size_t live_ = 0;//已启动的定时器数量
+    EventPoller::DelayTask::Ptr tick_task_;
+};//class CoarseTimerWheel
+
+CoarseTimer::CoarseTimer(OnTimer &&onTimer, const EventPoller::Ptr &poller)
+    : node_(std::make_shared<Node>(std::move(onTimer))), poller_(poller) {
+}
+
+CoarseTimer::~CoarseTimer() {
+    stop();
+}
+
+void CoarseTimer::start(int milliseconds) {
+    auto node = node_;
+    auto poller = poller_.get();
+    uint64_t period = milliseconds > 0 ? milliseconds : 1;
+    poller_->post([node, poller, period]()->void {
+        CoarseTimerWheel::instance(poller)->start(node, period);
+    });
+}
+
+void CoarseTimer::stop() {
+    auto node = node_;
+    auto poller = poller_.get();
+    poller_->post([node, poller]()->void {
+        CoarseTimerWheel::instance(poller)->stop(node);
+    });
+}
+
+}//namespace util
+}//namespace avc
@@ -0,0 +1,63 @@
+#ifndef TIMER_COARSETIMER_H
+#define TIMER_COARSETIMER_H
+
+#include <memory>
+
+#include "poller/EventPollerPool.h"
+
+/**
+ * 粗粒度定时器的刻度，单位毫秒
+*/
+#define COARSE_TIMER_RESOLUTION_MS  100
+/**
+ * 时间轮的槽数量，超过一圈(槽数量 * 刻度)的定时器在槽中等待多圈
+*/
+#define COARSE_TIMER_WHEEL_SLOTS    512
+
+namespace avc {
+namespace util {
+
+/**
+ * 粗粒度定时器：用于保活、超时检测等数量多、精度要求低、经常重置的定时器
+ *      同一EventPoller中的所有CoarseTimer共用一个时间轮（保存在EventPoller中），时间轮只向EventPoller注册一个周期DelayTask，
+ *      每COARSE_TIMER_RESOLUTION_MS唤醒一次（没有定时器时不唤醒）
+ *      启动、重置、停止都是O(1)，不会向EventPoller添加DelayTask；同一刻度内重复重置不做任何操作
+ *      回调在[到期时间, 到期时间 + COARSE_TIMER_RESOLUTION_MS)内执行
+ *
+ *  回调在EventPoller线程中执行；在其他线程调用start/stop时，通过EventPoller::post转到轮询线程执行
+ *  与Timer::stop(false)相同，其他线程释放CoarseTimer时不等待正在执行的回调
+*/
+class CoarseTimer : Nocopyable {
+public:
+    using Ptr = std::shared_ptr<CoarseTimer>;
+    using OnTimer = std::function<void()>;
+
+    AVC_STATIC_CREATOR(CoarseTimer)
+    ~CoarseTimer();
+
+    /**
+     * 启动周期定时器：从调用时开始计时，milliseconds后回调，此后每milliseconds回调一次
+     *      已经启动时再次调用即重置（例如收到数据后重置保活定时器）
+    */
+    void start(int milliseconds);
+    /**
+     * 停止定时器
+    */
+    void stop();
+private:
+    CoarseTimer(OnTimer &&onTimer, const EventPoller::Ptr &poller);
+private:
+    friend class CoarseTimerWheel;
+    /**
+     * 定时器状态，由时间轮与CoarseTimer共享，只在轮询线程中访问
+    */
+    struct Node;
+    std::shared_ptr<Node> node_;
+
+    EventPoller::Ptr poller_;
+};//class CoarseTimer
+
+}//namespace util
+}//namespace avc
+
+#endif
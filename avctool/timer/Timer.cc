@@ -9,7 +9,7 @@ Timer::~Timer() {
     stop();
 }
 
-void Timer::start(int milliseconds) {
+void Timer::start(int milliseconds, int slackMs, DelaySchedule schedule) {
     if (delay_task_ == nullptr) {
 
         std::weak_ptr<Timer> self = shared_from_this();
@@ -20,13 +20,16 @@ void Timer::start(int milliseconds) {
                     return milliseconds;
                 }
                 return 0;
-            });
+            }, slackMs, schedule);
     }
 }
 
-void Timer::stop() {
+void Timer::stop(bool waitCompletion) {
     if (delay_task_) {
         delay_task_->cancel();
+        if (waitCompletion) {
+            delay_task_->wait();
+        }
         delay_task_ = nullptr;
     }
 }
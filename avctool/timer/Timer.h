@@ -19,8 +19,20 @@ public:
     AVC_STATIC_CREATOR(Timer)
     ~Timer();
 
-    void start(int milliseconds);
-    void stop();
+    /**
+     * 启动周期定时器
+     * @param slackMs 允许推迟执行的时间，单位毫秒，见EventPoller::addDelayTask
+     *                保活、超时检测等大量且对精度要求不高的定时器，设置slack后可以合并唤醒
+     * @param schedule 重新调度方式：默认kFixedDelay；kFixedRate按到期时间计算下一个周期，不产生漂移，
+     *                 回调执行较晚时最多连续补执行maxBurst次，见DelaySchedule
+    */
+    void start(int milliseconds, int slackMs = 0, DelaySchedule schedule = DelaySchedule());
+    /**
+     * 停止定时器
+     * @param waitCompletion 是否等待正在执行的定时器回调结束
+     *                       在定时器回调内部调用时，不会等待
+    */
+    void stop(bool waitCompletion = false);
 private:
     Timer(OnTimer &&onTimer, const EventPoller::Ptr &poller);
 
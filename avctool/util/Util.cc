@@ -4,6 +4,13 @@
 #include <string>
 #include <sstream>
 #include <thread>
+#include <set>
+#include <mutex>
+#include <time.h>
+
+#if !defined(_WIN32)
+#include <sys/time.h>
+#endif
 
 #if defined(_MSC_VER)
 #include <Windows.h>
@@ -15,8 +22,14 @@ namespace avc {
 namespace util {
 
 
+/**
+ * getThreadNameCached的线程内缓存
+*/
+static thread_local const char *s_thread_name_cache = nullptr;
+
 void setThreadName(const char *name) {
   //assert(name);
+  s_thread_name_cache = nullptr;
 #if defined(__linux) || defined(__linux__) || defined(__MINGW32__)
   pthread_setname_np(pthread_self(), limitString(name, 16).data());
 #elif defined(__MACH__) || defined(__APPLE__)
@@ -125,6 +138,19 @@ std::string getThreadName()
 #endif
 }
 
+const char *getThreadNameCached() {
+  if (s_thread_name_cache) {
+    return s_thread_name_cache;
+  }
+  //线程名称数量有限，驻留后不再释放（不析构，避免进程退出时其他线程仍在使用）
+  static auto s_names = new std::set<std::string>();
+  static auto s_mutex = new std::mutex();
+  auto name = getThreadName();
+  std::lock_guard<std::mutex> lock(*s_mutex);
+  s_thread_name_cache = s_names->emplace(std::move(name)).first->c_str();
+  return s_thread_name_cache;
+}
+
 #if defined(_WIN32)
 
 void sleep(int second) {
@@ -203,85 +229,67 @@ static inline uint64_t getCurrentMicrosecondOrigin() {
     return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
 #else
     //通过gettimeofday
-    struct timeval;
+    struct timeval tv;
     gettimeofday(&tv, nullptr);
     return tv.tv_sec * 1000000L + tv.tv_usec;
 #endif
 }
 
 /**
- * 程序启动时间： 毫秒级别与微秒级别
+ * 读取单调时钟，单位纳秒（未减去程序启动时间）
 */
-static std::atomic<uint64_t> s_currentMillisecond(0);
-static std::atomic<uint64_t> s_currentMicrosecond(0);
+static inline uint64_t readMonotonicNanosecond(ClockPrecision precision) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC_COARSE)
+    clock_gettime(precision == kClockCoarse ? CLOCK_MONOTONIC_COARSE : CLOCK_MONOTONIC, &ts);
+#else
+    (void)precision;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+    (void)precision;
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 /**
- * 当前系统时间：自Epoch以来的时间，单位毫秒与微秒
+ * 程序启动时的单调时钟，程序启动时间以此为起点
+ *      静态初始化时读取；其他静态对象初始化时调用getMonotonicNanosecond也能得到正确的起点
 */
-static std::atomic<uint64_t> s_currentMillisecondSystem(getCurrentMicrosecondOrigin() / 1000L);
-static std::atomic<uint64_t> s_currentMicrosecondSystem(getCurrentMicrosecondOrigin());
-
-static bool initMillisecondThread() {
-    static std::thread s_thread([]()->void{
-        setThreadName("Stamp Thread");
-        DebugL << "Stamp Thread Started";
-
-        uint64_t last = getCurrentMicrosecondOrigin();
-        uint64_t now;
-        uint64_t microsecond = 0;
-        while (true) {
-            //获取当前系统时间
-            now = getCurrentMicrosecondOrigin();
-            /**
-             * release保证，写操作之后的读写操作，都不会重新排序到写操作之前
-            */
-            s_currentMicrosecondSystem.store(now, std::memory_order::memory_order_release);
-            s_currentMillisecondSystem.store(now / 1000L, std::memory_order::memory_order_release);
+static uint64_t monotonicOrigin() {
+    //减去1ms，保证程序启动时间从非0值开始递增
+    static uint64_t s_origin = readMonotonicNanosecond(kClockPrecise) - 1000000ULL;
+    return s_origin;
+}
+static uint64_t s_monotonic_origin_init = monotonicOrigin();
 
-            uint64_t elapse = now - last;
-            last = now;
-            if (elapse > 0 && elapse < 1000 * 1000) {
-                //获取系统时间计算时间间隔在0~1000ms之间，认为是正常的自增
-                microsecond += elapse;
-                s_currentMicrosecond.store(microsecond, std::memory_order::memory_order_release);
-                s_currentMillisecond.store(microsecond / 1000L, std::memory_order::memory_order_release);
-            }
-            else {
-                WarnL << "Stamp elapse is abnormal: " << elapse << "us";
-            }
-            //sleep 0.5 ms
-            usleep(500);
-        }
-    });
+uint64_t getMonotonicNanosecond(ClockPrecision precision) {
+    auto now = readMonotonicNanosecond(precision);
+    auto origin = monotonicOrigin();
+    //COARSE时钟可能略早于启动时读取的精确时钟
+    return now > origin ? now - origin : 0;
+}
 
-    static OnceToken once([&]()->void{
-        s_thread.detach();
-    });
-    return true;
+uint64_t getMonotonicOrigin() {
+    return monotonicOrigin();
 }
 
 uint64_t getCurrentMillisecond(bool systemTime) {
-  /**
-   * 调用getCurrentMillisecond函数后，才会启动时间戳线程
-   * 因此如果getCurrentMillisecond函数未计时调用，则获取到的当前时间可能存在误差
-  */
-  static bool flag = initMillisecondThread();
   if (systemTime) {
-      /**
-       * acquire保证，所有读操作之前的读写操作，都不会在读操作之后
-      */
-      return s_currentMillisecondSystem.load(std::memory_order::memory_order_acquire);
+      return getCurrentMicrosecondOrigin() / 1000;
   }
-  return s_currentMillisecond.load(std::memory_order::memory_order_acquire);
+  return getMonotonicNanosecond(kClockPrecise) / 1000000;
 }
 
 uint64_t getCurrentMicrosecond(bool systemTime) {
-    static bool flag = initMillisecondThread();
     if (systemTime) {
-        return s_currentMicrosecondSystem.load(std::memory_order::memory_order_acquire);
+        return getCurrentMicrosecondOrigin();
     }
-    return s_currentMicrosecond.load(std::memory_order::memory_order_acquire);
+    return getMonotonicNanosecond(kClockPrecise) / 1000;
 }
 
-
 }
 }
\ No newline at end of file
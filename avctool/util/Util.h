@@ -3,6 +3,10 @@
 
 #include <string>
 #include <stdarg.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <strings.h>//先声明系统的bzero，再定义下面的bzero宏（已声明时不再定义）
+#endif
 
 #include <mutex>
 #include <functional>
@@ -48,6 +52,12 @@ void setThreadName(const char *name);
  * 获取调用现场的名称 
 */
 std::string getThreadName();
+/**
+ * 获取调用线程的名称（线程内缓存，不申请内存）
+ *      名称驻留在进程级的表中，返回的指针在进程生命周期内有效，可以跨线程保存
+ *      setThreadName后重新获取
+*/
+const char *getThreadNameCached();
 
 void setThreadAffinity(int index);
 
@@ -78,14 +88,42 @@ std::string filename(const std::string& path);
  * @brief 获取Epoch(1970-01-01 00:00:00 UTC)至今的毫秒数
  * @param systemTime 是否为系统时间；否则为程序启动时间
  * 
- *        通过启动一个线程方式，去更新当前系统时间和程序启动时间
- *        系统时间伴随着用户修改系统本地时间而变化；而程序启动时间不随用户修改系统本地时间的变化而变化
+ *        每次调用直接读取时钟（Linux下clock_gettime通过vDSO读取，不陷入内核），没有后台线程
+ *        系统时间伴随着用户修改系统本地时间而变化；而程序启动时间基于单调时钟，不随用户修改系统本地时间的变化而变化
  *        因此可以认为：
  *             系统时间（可回退）；程序启动时间（不可回退，一直递增）
 */
 uint64_t getCurrentMillisecond(bool systemTime = false);
 uint64_t getCurrentMicrosecond(bool systemTime = false);
 
+/**
+ * 单调时钟精度
+ *      kClockCoarse：CLOCK_MONOTONIC_COARSE，读取最快，精度为内核tick（通常1~4ms），适合超时判断等粗粒度计时
+ *      kClockPrecise：CLOCK_MONOTONIC，微秒级精度，适合耗时统计与定时器
+ *  不支持COARSE的平台两者相同
+*/
+enum ClockPrecision {
+    kClockCoarse,
+    kClockPrecise,
+};//enum ClockPrecision
+
+/**
+ * 单调时钟：程序启动至今的时间，不随系统时间修改而变化
+*/
+uint64_t getMonotonicNanosecond(ClockPrecision precision = kClockPrecise);
+inline uint64_t getMonotonicMicrosecond(ClockPrecision precision = kClockPrecise) {
+    return getMonotonicNanosecond(precision) / 1000;
+}
+inline uint64_t getMonotonicMillisecond(ClockPrecision precision = kClockPrecise) {
+    return getMonotonicNanosecond(precision) / 1000000;
+}
+/**
+ * 程序启动时间对应的CLOCK_MONOTONIC时间，单位纳秒
+ *      getMonotonicNanosecond() + getMonotonicOrigin()即为CLOCK_MONOTONIC的绝对时间，
+ *      用于timerfd(TFD_TIMER_ABSTIME)等使用绝对时间的接口
+*/
+uint64_t getMonotonicOrigin();
+
 
 #ifndef bzero
 #define bzero(ptr,size)  memset((ptr),0,(size));